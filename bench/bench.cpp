@@ -0,0 +1,354 @@
+// Benchmark suite for the marketplace core, built and run by `make bench`.
+//
+// Usage: aimarket_bench [--quick] [--filter TEXT] [--output FILE]
+//
+//   --quick        smaller data sizes and shorter runs, for a fast smoke check
+//   --filter TEXT  only run benchmarks whose name contains TEXT
+//   --output FILE  write results to FILE instead of standard output
+//
+// Results are CSV, one line per benchmark and data size:
+//
+//   benchmark,size,iterations,total_ns,ns_per_op,ops_per_sec
+//
+// size is the benchmark's data-size parameter: ledger transactions, input
+// bytes, weight bytes or catalog entries, as noted next to each benchmark.
+// The library's own console output is discarded while the suite runs, so the
+// results stay machine-readable. Model files are written to a scratch
+// directory that is removed afterwards.
+#include "agent.hpp"
+#include "blockchain.hpp"
+#include "model.hpp"
+#include "storage.hpp"
+#include "utils.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+    // Swallows everything the library prints
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return traits_type::not_eof(c); }
+        std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+    };
+
+    // Keeps results alive so the optimizer cannot drop the measured work
+    volatile std::uint64_t sink = 0;
+
+    class BenchRunner {
+    public:
+        BenchRunner(std::ostream& out, bool quick, std::string filter)
+            : out(out), quick(quick), filter(std::move(filter)) {
+            out << std::fixed << std::setprecision(2);
+            out << "benchmark,size,iterations,total_ns,ns_per_op,ops_per_sec\n";
+        }
+
+        bool isQuick() const { return quick; }
+
+        bool enabled(const std::string& name) const {
+            return filter.empty() || name.find(filter) != std::string::npos;
+        }
+
+        // Lets a group skip its setup when none of its benchmarks will run
+        bool anyEnabled(std::initializer_list<const char*> names) const {
+            for (const char* name : names) {
+                if (enabled(name)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Calls body until the time budget is spent (at least once); each call
+        // counts as opsPerCall operations
+        template <typename Body>
+        void run(const std::string& name, std::size_t size, std::uint64_t opsPerCall, Body body) {
+            if (!enabled(name)) {
+                return;
+            }
+            const auto budget = std::chrono::milliseconds(quick ? 50 : 500);
+            std::uint64_t calls = 0;
+            std::chrono::nanoseconds elapsed{0};
+            do {
+                auto start = std::chrono::steady_clock::now();
+                body();
+                elapsed += std::chrono::steady_clock::now() - start;
+                calls++;
+            } while (elapsed < budget);
+
+            std::uint64_t ops = calls * opsPerCall;
+            double totalNs = static_cast<double>(elapsed.count());
+            double nsPerOp = totalNs / static_cast<double>(ops);
+            out << name << ',' << size << ',' << ops << ',' << elapsed.count() << ','
+                << nsPerOp << ',' << (nsPerOp > 0.0 ? 1e9 / nsPerOp : 0.0) << '\n';
+            out.flush();
+        }
+
+    private:
+        std::ostream& out;
+        bool quick;
+        std::string filter;
+    };
+
+    const std::vector<MediaType> ALL_TYPES = {MediaType::TEXT, MediaType::IMAGE,
+                                              MediaType::AUDIO, MediaType::VIDEO};
+
+    // A ledger of count transactions over 100 models: creations, rentals with
+    // and without expiry, votes and plain transfers
+    void fillLedger(BlockchainLedger& ledger, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            std::string modelId = "model-" + std::to_string(i % 100);
+            switch (i % 4) {
+                case 0:
+                    ledger.addTransaction("CREATE", modelId, "system", "", 0.0);
+                    break;
+                case 1:
+                    ledger.addTransaction("RENT", modelId, "owner", "user-" + std::to_string(i % 37),
+                                          5.0, 3600);
+                    break;
+                case 2:
+                    ledger.addVote(modelId, "user-" + std::to_string(i % 37),
+                                   static_cast<int>(i % 5) + 1, "review");
+                    break;
+                default:
+                    ledger.addTransaction("TRANSFER", modelId, "owner", "buyer", 10.0);
+                    break;
+            }
+        }
+    }
+
+    void benchLedger(BenchRunner& bench) {
+        std::vector<std::size_t> sizes = bench.isQuick() ? std::vector<std::size_t>{100, 1000}
+                                                         : std::vector<std::size_t>{100, 1000, 10000};
+        for (std::size_t count : sizes) {
+            // size: transactions appended per run
+            bench.run("ledger_append", count, count, [&] {
+                BlockchainLedger ledger;
+                for (std::size_t i = 0; i < count; ++i) {
+                    ledger.addTransaction("TRANSFER", "model-" + std::to_string(i % 100),
+                                          "owner", "buyer", 10.0);
+                }
+                sink = sink + ledger.getTransactions().size();
+            });
+
+            if (!bench.anyEnabled({"ledger_verify_chain", "ledger_rental_available",
+                                   "ledger_rental_rented_by", "ledger_price_fair"})) {
+                continue;
+            }
+            BlockchainLedger ledger;
+            fillLedger(ledger, count);
+
+            // size: transactions in the ledger, for all of the queries below
+            bench.run("ledger_verify_chain", count, 1, [&] {
+                sink = sink + ledger.verifyChain();
+            });
+            std::uint64_t query = 0;
+            bench.run("ledger_rental_available", count, 1, [&] {
+                sink = sink + ledger.isModelAvailableForRent("model-" + std::to_string(query++ % 100));
+            });
+            bench.run("ledger_rental_rented_by", count, 1, [&] {
+                std::string modelId = "model-" + std::to_string(query % 100);
+                sink = sink + ledger.isModelRentedBy(modelId, "user-" + std::to_string(query++ % 37));
+            });
+            bench.run("ledger_price_fair", count, 1, [&] {
+                sink = sink + static_cast<std::uint64_t>(
+                    ledger.calculateFairPrice("model-" + std::to_string(query++ % 100)));
+            });
+        }
+    }
+
+    void benchHash(BenchRunner& bench) {
+        std::vector<std::size_t> sizes = bench.isQuick() ? std::vector<std::size_t>{64, 4096}
+                                                         : std::vector<std::size_t>{64, 4096, 1 << 20};
+        for (std::size_t bytes : sizes) {
+            std::string input(bytes, 'a');
+            // size: input bytes
+            bench.run("hash_string", bytes, 1, [&] {
+                input[0]++;
+                sink = sink + utils::hashString(input).size();
+            });
+        }
+    }
+
+    std::size_t weightBytes(const AIModel& model) {
+        std::size_t bytes = 0;
+        for (MediaType type : model.getSupportedTypes()) {
+            bytes += model.getSectionWeights(type).size();
+        }
+        return bytes;
+    }
+
+    void benchModel(BenchRunner& bench) {
+        std::vector<std::vector<MediaType>> layouts = {{MediaType::TEXT}};
+        if (!bench.isQuick()) {
+            layouts.push_back({MediaType::TEXT, MediaType::IMAGE});
+        }
+        for (const auto& types : layouts) {
+            if (!bench.anyEnabled({"model_train", "model_validate", "model_save", "model_load"})) {
+                return;
+            }
+            AIModel model("BenchModel", types);
+            model.train();
+            // size: weight bytes of the model, for train, validate, save and load
+            std::size_t bytes = weightBytes(model);
+
+            bench.run("model_train", bytes, 1, [&] {
+                model.train();
+            });
+            bench.run("model_validate", bytes, 1, [&] {
+                sink = sink + model.validate();
+            });
+            bench.run("model_save", bytes, 1, [&] {
+                model.save();
+            });
+
+            if (!bench.enabled("model_load")) {
+                continue;
+            }
+            // Loading maps the file; touching every section makes it resident
+            model.save();
+            std::string id = model.getId();
+            unsigned int version = model.getVersion();
+            bench.run("model_load", bytes, 1, [&] {
+                AIModel loaded("BenchModel", types);
+                loaded.load(id, version);
+                sink = sink + weightBytes(loaded);
+            });
+        }
+    }
+
+    void benchStorage(BenchRunner& bench) {
+        std::vector<std::size_t> sizes = bench.isQuick() ? std::vector<std::size_t>{1000}
+                                                         : std::vector<std::size_t>{1000, 100000};
+        for (std::size_t count : sizes) {
+            if (!bench.anyEnabled({"storage_get_record", "storage_get_model", "storage_latest_version",
+                                   "storage_find_records", "storage_count_matching"})) {
+                continue;
+            }
+            ModelStorage storage;
+            std::vector<std::string> ids;
+            ids.reserve(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                // Every model supports TEXT plus one other type
+                std::vector<MediaType> types = {MediaType::TEXT, ALL_TYPES[1 + i % 3]};
+                auto model = std::make_shared<AIModel>("bench-" + std::to_string(i % 1000), types);
+                ids.push_back(model->getId());
+                storage.storeModel(std::move(model));
+            }
+
+            // size: models in the catalog, for all of the lookups below
+            std::uint64_t query = 0;
+            bench.run("storage_get_record", count, 1, [&] {
+                sink = sink + storage.getRecord(ids[query++ % count]).has_value();
+            });
+            bench.run("storage_get_model", count, 1, [&] {
+                sink = sink + (storage.getModel(ids[query++ % count]) != nullptr);
+            });
+            bench.run("storage_latest_version", count, 1, [&] {
+                sink = sink + storage.getLatestVersion("bench-" + std::to_string(query++ % 1000)).has_value();
+            });
+            ModelQuery find;
+            find.mediaTypes = static_cast<uint32_t>(MediaType::AUDIO);
+            find.minAccuracy = 0.0;
+            find.limit = 10;
+            bench.run("storage_find_records", count, 1, [&] {
+                find.offset = query++ % 100;
+                sink = sink + storage.findRecords(find).size();
+            });
+            bench.run("storage_count_matching", count, 1, [&] {
+                sink = sink + storage.countMatching(find);
+            });
+        }
+    }
+
+    void benchAgent(BenchRunner& bench) {
+        std::vector<std::size_t> sizes = bench.isQuick() ? std::vector<std::size_t>{1024}
+                                                         : std::vector<std::size_t>{1024, 1 << 20};
+        for (std::size_t bytes : sizes) {
+            // A fresh agent per size, so no size inherits what the last one learned
+            auto model = std::make_shared<AIModel>("BenchAgentModel", std::vector<MediaType>{MediaType::TEXT});
+            ModelAgent agent(model);
+            AgentContext context{
+                .mediaType = MediaType::TEXT,
+                .payload = AgentPayload(std::string(bytes, 'x')),
+                .parameters = {{"mode", "process"}}
+            };
+            // size: payload bytes
+            bench.run("agent_decide", bytes, 1, [&] {
+                sink = sink + static_cast<std::uint64_t>(agent.decideNextAction(context));
+            });
+            // Runs whatever the agent picks: the end-to-end cost, training included
+            bench.run("agent_process_context", bytes, 1, [&] {
+                agent.processContext(context);
+            });
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bool quick = false;
+    std::string filter;
+    std::string outputPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--quick") {
+            quick = true;
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--output" && i + 1 < argc) {
+            outputPath = std::filesystem::absolute(argv[++i]).string();
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--quick] [--filter TEXT] [--output FILE]\n";
+            return 1;
+        }
+    }
+
+    std::ofstream file;
+    if (!outputPath.empty()) {
+        file.open(outputPath);
+        if (!file) {
+            std::cerr << "Error: Cannot write " << outputPath << std::endl;
+            return 1;
+        }
+    }
+    std::streambuf* console = std::cout.rdbuf();
+    std::ostream results(outputPath.empty() ? console : file.rdbuf());
+
+    // Model files go to models/ under the working directory
+    std::filesystem::path original = std::filesystem::current_path();
+    std::filesystem::path scratch = std::filesystem::temp_directory_path() /
+                                    ("aimarket-bench-" + std::to_string(::getpid()));
+    std::filesystem::create_directories(scratch / "models");
+    std::filesystem::current_path(scratch);
+
+    NullBuffer discard;
+    std::cout.rdbuf(&discard);
+    int status = 0;
+    try {
+        BenchRunner bench(results, quick, filter);
+        benchLedger(bench);
+        benchHash(bench);
+        benchModel(bench);
+        benchStorage(bench);
+        benchAgent(bench);
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        status = 1;
+    }
+    std::cout.rdbuf(console);
+
+    std::filesystem::current_path(original);
+    std::filesystem::remove_all(scratch);
+    return status;
+}
@@ -1,23 +1,141 @@
 #include "agent.hpp"
 #include <algorithm>
+#include <bit>
 #include <numeric>
+#include <cctype>
 #include <cmath>
+#include <cstring>
+#include <filesystem>
 #include <sstream>
 #include <iostream>
+#include <stdexcept>
+
+namespace {
+    // Agent snapshot file, in host byte order like the model catalog:
+    //
+    //   magic | formatVersion | actionCount | score[actionCount]
+    //   | historySize | record[historySize], oldest first | checksum
+    //
+    // A record is action (u8), mediaType (u8), success (u8), inputSize (u64).
+    const char STATE_MAGIC[8] = {'A', 'I', 'M', 'A', 'G', 'N', 'T', '\0'};
+    constexpr uint32_t STATE_FORMAT_VERSION = 1;
+
+    // MediaType values are single bits
+    bool isMediaType(uint8_t value) {
+        return std::has_single_bit(value) && value <= static_cast<uint8_t>(MediaType::VIDEO);
+    }
+
+    template <typename T>
+    void put(std::vector<uint8_t>& out, const T& value) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    class StateReader {
+    public:
+        StateReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+        template <typename T>
+        T get() {
+            if (sizeof(T) > size - offset) {
+                throw std::runtime_error("truncated snapshot");
+            }
+            T value;
+            std::memcpy(&value, data + offset, sizeof(T));
+            offset += sizeof(T);
+            return value;
+        }
+
+        bool atEnd() const { return offset == size; }
+
+    private:
+        const uint8_t* data;
+        size_t size;
+        size_t offset = 0;
+    };
+}
+
+AgentStateOptions AgentStateOptions::forModel(const AIModel& model) {
+    std::string name = model.getName();
+    for (char& c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') {
+            c = '_';
+        }
+    }
+    AgentStateOptions options;
+    options.path = "agents/" + name + ".agent";
+    return options;
+}
+
+AgentPayload::AgentPayload(std::vector<uint8_t> bytes) {
+    auto held = std::make_shared<const std::vector<uint8_t>>(std::move(bytes));
+    begin = held->data();
+    length = held->size();
+    owner = std::move(held);
+}
+
+AgentPayload::AgentPayload(std::string text) {
+    auto held = std::make_shared<const std::string>(std::move(text));
+    begin = reinterpret_cast<const uint8_t*>(held->data());
+    length = held->size();
+    owner = std::move(held);
+}
+
+AgentPayload::AgentPayload(utils::FileBuffer file) {
+    auto held = std::make_shared<const utils::FileBuffer>(std::move(file));
+    begin = held->data();
+    length = held->size();
+    owner = std::move(held);
+}
 
-ModelAgent::ModelAgent(std::shared_ptr<AIModel> model)
-    : model(model), state(AgentState::IDLE) {
-    // Initialize action scores
-    actionScores[AgentAction::ANALYZE] = 1.0;
-    actionScores[AgentAction::TRAIN] = 1.0;
-    actionScores[AgentAction::PROCESS] = 1.0;
-    actionScores[AgentAction::WAIT] = 0.5;
+AgentPayload::AgentPayload(std::shared_ptr<MediaReader> stream) : reader(std::move(stream)) {}
+
+ContextFeatures ContextFeatures::of(const AgentContext& context) {
+    ContextFeatures features{context.mediaType, !context.payload.empty(), context.payload.size(),
+                             ContextMode::NONE, nullptr};
+    auto mode = context.parameters.find("mode");
+    if (mode != context.parameters.end()) {
+        features.modeText = &mode->second;
+        if (mode->second == "training") {
+            features.mode = ContextMode::TRAINING;
+        } else if (mode->second == "analysis") {
+            features.mode = ContextMode::ANALYSIS;
+        } else {
+            features.mode = ContextMode::OTHER;
+        }
+    }
+    return features;
+}
+
+ModelAgent::ModelAgent(std::shared_ptr<AIModel> model, std::shared_ptr<BufferPool> bufferPool,
+                       AgentStateOptions persistence)
+    : model(model), bufferPool(bufferPool), state(AgentState::IDLE),
+      persistence(std::move(persistence)) {
+    if (!this->bufferPool) {
+        this->bufferPool = std::make_shared<BufferPool>();
+    }
+    // Initialize action scores, indexed by AgentAction
+    actionScores = {1.0, 1.0, 1.0, 0.5};
+    if (!this->persistence.path.empty() && std::filesystem::exists(this->persistence.path)) {
+        restored = loadState();
+    }
+}
+
+ModelAgent::~ModelAgent() {
+    if (unsavedChanges == 0) {
+        return;
+    }
+    try {
+        saveState();
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to save agent state: " << e.what() << std::endl;
+    }
 }
 
 void ModelAgent::processContext(const AgentContext& context) {
     if (!validateContext(context)) {
         setState(AgentState::ERROR);
-        lastReasoning = "Invalid context provided";
+        setReasoning("Invalid context provided");
         return;
     }
 
@@ -26,24 +144,112 @@ void ModelAgent::processContext(const AgentContext& context) {
     executeAction(nextAction, context);
 }
 
-AgentAction ModelAgent::decideNextAction(const AgentContext& context) {
-    std::vector<std::pair<AgentAction, double>> scores;
+size_t ModelAgent::processBatch(std::span<const AgentContext> contexts) {
+    // Groups in order of each media type's first appearance
+    std::vector<std::vector<const AgentContext*>> groups;
+    size_t handled = 0;
+    for (const auto& context : contexts) {
+        // A minibatch update needs every sample in memory
+        if (!validateContext(context) || context.payload.stream()) {
+            continue;
+        }
+        auto group = std::find_if(groups.begin(), groups.end(), [&](const auto& members) {
+            return members.front()->mediaType == context.mediaType;
+        });
+        if (group == groups.end()) {
+            groups.emplace_back();
+            group = groups.end() - 1;
+        }
+        group->push_back(&context);
+        handled++;
+    }
+    if (groups.empty()) {
+        setState(AgentState::ERROR);
+        setReasoning("Invalid context provided");
+        return 0;
+    }
+
+    for (const auto& group : groups) {
+        processGroup(group);
+    }
+    return handled;
+}
 
-    // Evaluate each possible action
-    for (const auto& [action, baseScore] : actionScores) {
-        double score = evaluateAction(action, context);
-        scores.push_back({action, score});
+void ModelAgent::processGroup(std::span<const AgentContext* const> valid) {
+    setState(AgentState::PROCESSING);
+    AgentAction nextAction = decideNextAction(*valid.front());
+    if (nextAction != AgentAction::TRAIN) {
+        for (const AgentContext* context : valid) {
+            executeAction(nextAction, *context);
+        }
+        return;
+    }
+
+    MediaType type = valid.front()->mediaType;
+    std::vector<std::span<const uint8_t>> samples;
+    samples.reserve(valid.size());
+    uint64_t bytes = 0;
+    for (const AgentContext* context : valid) {
+        samples.push_back(context->payload.bytes());
+        bytes += context->payload.size();
+    }
+
+    bool success = true;
+    try {
+        std::cout << "Training model with batch of " << valid.size() << " "
+                  << static_cast<int>(type) << " samples...\n";
+        double learningRate = AIModel::DEFAULT_LEARNING_RATE;
+        auto rate = valid.front()->parameters.find("learning_rate");
+        if (rate != valid.front()->parameters.end()) {
+            learningRate = std::stod(rate->second);
+        }
+        model->trainBatch(type, samples, learningRate);
+    } catch (const std::exception& e) {
+        success = false;
+        setState(AgentState::ERROR);
+        std::cerr << "Error executing action: " << e.what() << std::endl;
     }
 
-    // Choose the action with highest score
-    auto maxScore = std::max_element(scores.begin(), scores.end(),
-        [](const auto& a, const auto& b) { return a.second < b.second; });
+    // The batch was one decision and one update, so it is learned from once
+    logDecision(DecisionRecord{nextAction, type, success, bytes});
+    updateBehavior(*valid.front(), success);
+}
 
-    lastReasoning = generateReasoning(maxScore->first, context);
-    return maxScore->first;
+AgentAction ModelAgent::decideNextAction(const AgentContext& context) {
+    ContextFeatures features = ContextFeatures::of(context);
+    double accuracy = model->getAccuracy();
+
+    // Evaluate each possible action; the first of equal scores wins
+    AgentAction best = AgentAction::ANALYZE;
+    double bestScore = scoreAction(best, features, accuracy);
+    for (size_t i = 1; i < ACTION_COUNT; ++i) {
+        auto action = static_cast<AgentAction>(i);
+        double score = scoreAction(action, features, accuracy);
+        if (score > bestScore) {
+            best = action;
+            bestScore = score;
+        }
+    }
+
+    lastDecision.action = best;
+    lastDecision.mediaType = features.mediaType;
+    lastDecision.inputSize = features.inputSize;
+    lastDecision.accuracy = accuracy;
+    lastDecision.hasMode = features.modeText != nullptr;
+    if (best == AgentAction::ANALYZE && lastDecision.hasMode) {
+        lastDecision.modeText = *features.modeText;
+    } else {
+        lastDecision.modeText.clear();
+    }
+    reasoningStale = true;
+    return best;
 }
 
 void ModelAgent::executeAction(AgentAction action, const AgentContext& context) {
+    recordOutcome(action, context, performAction(*model, action, context));
+}
+
+bool ModelAgent::performAction(AIModel& target, AgentAction action, const AgentContext& context) const {
     bool success = true;
     try {
         switch (action) {
@@ -56,40 +262,43 @@ void ModelAgent::executeAction(AgentAction action, const AgentContext& context)
             case AgentAction::TRAIN:
                 std::cout << "Training model with new " 
                          << static_cast<int>(context.mediaType) << " data...\n";
+                if (MediaReader* stream = context.payload.stream()) {
+                    StreamTrainingOptions options;
+                    auto chunkSize = context.parameters.find("chunk_size");
+                    if (chunkSize != context.parameters.end()) {
+                        options.chunkSize = std::stoull(chunkSize->second);
+                    }
+                    target.trainWithStream(context.mediaType, *stream, options);
+                    break;
+                }
                 switch (context.mediaType) {
                     case MediaType::TEXT:
-                        model->trainWithText(context.input);
+                        target.trainWithText(context.payload.text());
                         break;
                     case MediaType::IMAGE:
-                        model->trainWithImage(context.binaryData);
+                        target.trainWithImage(context.payload.bytes());
                         break;
                     case MediaType::AUDIO:
-                        model->trainWithAudio(context.binaryData);
+                        target.trainWithAudio(context.payload.bytes());
                         break;
                     case MediaType::VIDEO:
-                        model->trainWithVideo(context.binaryData);
+                        target.trainWithVideo(context.payload.bytes());
                         break;
                 }
                 break;
 
-            case AgentAction::PROCESS:
+            case AgentAction::PROCESS: {
                 std::cout << "Processing " << static_cast<int>(context.mediaType) 
                          << " content...\n";
-                switch (context.mediaType) {
-                    case MediaType::TEXT:
-                        model->processText(context.input);
-                        break;
-                    case MediaType::IMAGE:
-                        model->processImage(context.binaryData);
-                        break;
-                    case MediaType::AUDIO:
-                        model->processAudio(context.binaryData);
-                        break;
-                    case MediaType::VIDEO:
-                        model->processVideo(context.binaryData);
-                        break;
+                if (context.payload.stream()) {
+                    throw std::runtime_error("Streamed input can only be trained on");
                 }
+                // Process straight from the context into a pooled buffer
+                std::span<const uint8_t> input = context.payload.bytes();
+                auto output = bufferPool->acquire(target.processedSize(context.mediaType, input.size()));
+                target.processInto(context.mediaType, input, output.span());
                 break;
+            }
 
             case AgentAction::WAIT:
                 std::cout << "Agent waiting for better context...\n";
@@ -97,24 +306,33 @@ void ModelAgent::executeAction(AgentAction action, const AgentContext& context)
         }
     } catch (const std::exception& e) {
         success = false;
-        setState(AgentState::ERROR);
         std::cerr << "Error executing action: " << e.what() << std::endl;
     }
+    return success;
+}
 
+void ModelAgent::recordOutcome(AgentAction action, const AgentContext& context, bool success) {
+    if (!success) {
+        setState(AgentState::ERROR);
+    }
     logDecision(action, context, success);
     updateBehavior(context, success);
 }
 
 double ModelAgent::evaluateAction(AgentAction action, const AgentContext& context) {
-    double score = actionScores[action];
+    return scoreAction(action, ContextFeatures::of(context), model->getAccuracy());
+}
+
+double ModelAgent::scoreAction(AgentAction action, const ContextFeatures& features, double accuracy) const {
+    double score = actionScores[static_cast<size_t>(action)];
 
     // Adjust score based on context and media type
     switch (action) {
         case AgentAction::TRAIN:
             // Prefer training when accuracy is low
-            score *= (1.0 - model->getAccuracy());
+            score *= (1.0 - accuracy);
             // Adjust based on media type complexity
-            switch (context.mediaType) {
+            switch (features.mediaType) {
                 case MediaType::TEXT: score *= 1.2; break;
                 case MediaType::IMAGE: score *= 1.1; break;
                 case MediaType::AUDIO: score *= 1.0; break;
@@ -124,11 +342,9 @@ double ModelAgent::evaluateAction(AgentAction action, const AgentContext& contex
 
         case AgentAction::PROCESS:
             // Prefer processing when accuracy is high
-            score *= model->getAccuracy();
+            score *= accuracy;
             // Check if we have sufficient data
-            if (context.mediaType == MediaType::TEXT && context.input.empty()) {
-                score *= 0.5;
-            } else if (context.mediaType != MediaType::TEXT && context.binaryData.empty()) {
+            if (!features.hasInput) {
                 score *= 0.5;
             }
             break;
@@ -137,8 +353,7 @@ double ModelAgent::evaluateAction(AgentAction action, const AgentContext& contex
             // Prefer analysis for new or complex inputs
             score *= 0.8;
             // Adjust based on context parameters
-            if (context.parameters.find("mode") != context.parameters.end() &&
-                context.parameters.at("mode") == "analysis") {
+            if (features.mode == ContextMode::ANALYSIS) {
                 score *= 1.5;
             }
             break;
@@ -146,20 +361,15 @@ double ModelAgent::evaluateAction(AgentAction action, const AgentContext& contex
         case AgentAction::WAIT:
             // Low priority action, but higher if context is insufficient
             score *= 0.5;
-            if ((context.mediaType == MediaType::TEXT && context.input.empty()) ||
-                (context.mediaType != MediaType::TEXT && context.binaryData.empty())) {
+            if (!features.hasInput) {
                 score *= 2.0;
             }
             break;
     }
 
     // Consider past decisions
-    if (!decisionHistory.empty()) {
-        double successRate = std::count_if(decisionHistory.begin(), decisionHistory.end(),
-            [action](const Decision& d) { 
-                return d.action == action && d.success; 
-            }) / static_cast<double>(decisionHistory.size());
-        score *= (0.5 + successRate);
+    if (historySize > 0) {
+        score *= (0.5 + getSuccessRate(action));
     }
 
     return score;
@@ -170,16 +380,16 @@ void ModelAgent::updateBehavior(const AgentContext& context, bool success) {
     const double learningRate = 0.1;
     const double penalty = 0.8;
     const double reward = 1.2;
+    ContextMode mode = ContextFeatures::of(context).mode;
 
-    for (auto& [action, score] : actionScores) {
+    for (size_t i = 0; i < ACTION_COUNT; ++i) {
+        auto action = static_cast<AgentAction>(i);
+        double& score = actionScores[i];
         // Apply context-specific adjustments
         double contextMultiplier = 1.0;
-        if (context.parameters.find("mode") != context.parameters.end()) {
-            if (context.parameters.at("mode") == "training" && action == AgentAction::TRAIN) {
-                contextMultiplier *= (1.0 + learningRate);
-            } else if (context.parameters.at("mode") == "analysis" && action == AgentAction::ANALYZE) {
-                contextMultiplier *= (1.0 + learningRate);
-            }
+        if ((mode == ContextMode::TRAINING && action == AgentAction::TRAIN) ||
+            (mode == ContextMode::ANALYSIS && action == AgentAction::ANALYZE)) {
+            contextMultiplier *= (1.0 + learningRate);
         }
 
         if (success) {
@@ -204,10 +414,11 @@ void ModelAgent::learn(const AgentContext& context, const std::string& feedback)
                      feedback.find("poor") != std::string::npos;
 
     if (isPositive) {
-        actionScores[AgentAction::PROCESS] *= 1.1;
+        actionScores[static_cast<size_t>(AgentAction::PROCESS)] *= 1.1;
     } else if (isNegative) {
-        actionScores[AgentAction::TRAIN] *= 1.1;
+        actionScores[static_cast<size_t>(AgentAction::TRAIN)] *= 1.1;
     }
+    noteChange();
 }
 
 bool ModelAgent::validateContext(const AgentContext& context) const {
@@ -216,49 +427,199 @@ bool ModelAgent::validateContext(const AgentContext& context) const {
         return false;
     }
 
-    // Validate input based on media type
-    switch (context.mediaType) {
-        case MediaType::TEXT:
-            return !context.input.empty();
+    // Every media type needs some input
+    return !context.payload.empty();
+}
 
-        case MediaType::IMAGE:
-        case MediaType::AUDIO:
-        case MediaType::VIDEO:
-            return !context.binaryData.empty();
+double ModelAgent::getSuccessRate(AgentAction action) const {
+    if (historySize == 0) {
+        return 0.0;
     }
+    return actionSuccesses[static_cast<size_t>(action)] / static_cast<double>(historySize);
+}
 
-    return true;
+std::vector<DecisionRecord> ModelAgent::getDecisionHistory() const {
+    std::vector<DecisionRecord> history;
+    history.reserve(historySize);
+    for (size_t i = 0; i < historySize; ++i) {
+        history.push_back(decisionHistory[(historyStart + i) % HISTORY_CAPACITY]);
+    }
+    return history;
 }
 
 void ModelAgent::logDecision(AgentAction action, const AgentContext& context, bool success) {
-    decisionHistory.push_back({action, context, success});
-    if (decisionHistory.size() > 1000) { // Keep history bounded
-        decisionHistory.erase(decisionHistory.begin());
+    logDecision(DecisionRecord{action, context.mediaType, success, context.payload.size()});
+}
+
+void ModelAgent::logDecision(const DecisionRecord& record) {
+    if (historySize == HISTORY_CAPACITY) {
+        // Overwrite the oldest record and drop it from the counts
+        DecisionRecord& oldest = decisionHistory[historyStart];
+        if (oldest.success) {
+            actionSuccesses[static_cast<size_t>(oldest.action)]--;
+        }
+        oldest = record;
+        historyStart = (historyStart + 1) % HISTORY_CAPACITY;
+    } else {
+        decisionHistory[(historyStart + historySize) % HISTORY_CAPACITY] = record;
+        historySize++;
+    }
+    if (record.success) {
+        actionSuccesses[static_cast<size_t>(record.action)]++;
+    }
+    noteChange();
+}
+
+void ModelAgent::noteChange() {
+    if (persistence.path.empty()) {
+        return;
+    }
+    unsavedChanges++;
+    if (persistence.flushInterval == 0 || unsavedChanges < persistence.flushInterval) {
+        return;
+    }
+    try {
+        saveState();
+    } catch (const std::exception& e) {
+        // Keep counting; the next flush or the destructor tries again
+        std::cerr << "Failed to save agent state: " << e.what() << std::endl;
+    }
+}
+
+void ModelAgent::saveState() {
+    if (persistence.path.empty()) {
+        return;
+    }
+
+    std::vector<uint8_t> out(STATE_MAGIC, STATE_MAGIC + sizeof(STATE_MAGIC));
+    out.reserve(64 + historySize * 11);
+    put(out, STATE_FORMAT_VERSION);
+    put(out, static_cast<uint32_t>(ACTION_COUNT));
+    for (double score : actionScores) {
+        put(out, score);
+    }
+    put(out, static_cast<uint32_t>(historySize));
+    for (size_t i = 0; i < historySize; ++i) {
+        const DecisionRecord& record = decisionHistory[(historyStart + i) % HISTORY_CAPACITY];
+        put(out, static_cast<uint8_t>(record.action));
+        put(out, static_cast<uint8_t>(record.mediaType));
+        put(out, static_cast<uint8_t>(record.success));
+        put(out, record.inputSize);
+    }
+    put(out, utils::checksum64(out.data(), out.size()));
+
+    std::filesystem::path parent = std::filesystem::path(persistence.path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent);
+    }
+    utils::saveBinaryFile(persistence.path, out, true);
+    unsavedChanges = 0;
+}
+
+bool ModelAgent::loadState() {
+    // A snapshot that cannot be used costs a cold start, never the agent
+    try {
+        utils::FileBuffer file = utils::loadFile(persistence.path);
+        if (file.size() < sizeof(STATE_MAGIC) + sizeof(uint64_t) ||
+            std::memcmp(file.data(), STATE_MAGIC, sizeof(STATE_MAGIC)) != 0) {
+            throw std::runtime_error("not an agent snapshot");
+        }
+        size_t bodySize = file.size() - sizeof(uint64_t);
+        uint64_t stored;
+        std::memcpy(&stored, file.data() + bodySize, sizeof(stored));
+        if (utils::checksum64(file.data(), bodySize) != stored) {
+            throw std::runtime_error("checksum mismatch");
+        }
+
+        StateReader reader(file.data() + sizeof(STATE_MAGIC), bodySize - sizeof(STATE_MAGIC));
+        uint32_t formatVersion = reader.get<uint32_t>();
+        if (formatVersion != STATE_FORMAT_VERSION) {
+            throw std::runtime_error("unsupported format version " + std::to_string(formatVersion));
+        }
+        if (reader.get<uint32_t>() != ACTION_COUNT) {
+            throw std::runtime_error("action count mismatch");
+        }
+        std::array<double, ACTION_COUNT> scores;
+        for (double& score : scores) {
+            score = reader.get<double>();
+            if (!std::isfinite(score)) {
+                throw std::runtime_error("invalid action score");
+            }
+        }
+        uint32_t count = reader.get<uint32_t>();
+        if (count > HISTORY_CAPACITY) {
+            throw std::runtime_error("history larger than the agent keeps");
+        }
+        std::array<DecisionRecord, HISTORY_CAPACITY> history;
+        std::array<size_t, ACTION_COUNT> successes{};
+        for (uint32_t i = 0; i < count; ++i) {
+            uint8_t action = reader.get<uint8_t>();
+            uint8_t mediaType = reader.get<uint8_t>();
+            bool success = reader.get<uint8_t>() != 0;
+            uint64_t inputSize = reader.get<uint64_t>();
+            if (action >= ACTION_COUNT) {
+                throw std::runtime_error("invalid action in history");
+            }
+            if (!isMediaType(mediaType)) {
+                throw std::runtime_error("invalid media type in history");
+            }
+            history[i] = DecisionRecord{static_cast<AgentAction>(action),
+                                        static_cast<MediaType>(mediaType), success, inputSize};
+            if (success) {
+                successes[action]++;
+            }
+        }
+        if (!reader.atEnd()) {
+            throw std::runtime_error("trailing data");
+        }
+
+        actionScores = scores;
+        decisionHistory = history;
+        historyStart = 0;
+        historySize = count;
+        actionSuccesses = successes;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Ignoring agent state " << persistence.path << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+std::string ModelAgent::getActionReasoning() const {
+    if (reasoningStale) {
+        lastReasoning = generateReasoning(lastDecision);
+        reasoningStale = false;
     }
+    return lastReasoning;
 }
 
-std::string ModelAgent::generateReasoning(AgentAction action, const AgentContext& context) {
+void ModelAgent::setReasoning(std::string text) {
+    lastReasoning = std::move(text);
+    reasoningStale = false;
+}
+
+std::string ModelAgent::generateReasoning(const Reasoning& decision) const {
     std::stringstream ss;
-    ss << "Selected action: " << static_cast<int>(action) << " for media type "
-       << static_cast<int>(context.mediaType) << " because: ";
+    ss << "Selected action: " << static_cast<int>(decision.action) << " for media type "
+       << static_cast<int>(decision.mediaType) << " because: ";
 
-    switch (action) {
+    switch (decision.action) {
         case AgentAction::ANALYZE:
             ss << "Input requires analysis";
-            if (context.parameters.find("mode") != context.parameters.end()) {
-                ss << " (mode: " << context.parameters.at("mode") << ")";
+            if (decision.hasMode) {
+                ss << " (mode: " << decision.modeText << ")";
             }
             break;
         case AgentAction::TRAIN:
             ss << "Model accuracy can be improved (current: " 
-               << model->getAccuracy() << ")";
+               << decision.accuracy << ")";
             break;
         case AgentAction::PROCESS:
             ss << "Model is ready to process input";
-            if (context.mediaType == MediaType::TEXT) {
-                ss << " of length " << context.input.length();
+            if (decision.mediaType == MediaType::TEXT) {
+                ss << " of length " << decision.inputSize;
             } else {
-                ss << " of size " << context.binaryData.size() << " bytes";
+                ss << " of size " << decision.inputSize << " bytes";
             }
             break;
         case AgentAction::WAIT:
@@ -267,4 +628,4 @@ std::string ModelAgent::generateReasoning(AgentAction action, const AgentContext
     }
 
     return ss.str();
-}
\ No newline at end of file
+}
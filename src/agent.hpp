@@ -1,10 +1,17 @@
 #pragma once
 #include "model.hpp"
+#include "buffer_pool.hpp"
+#include "utils.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <memory>
 #include <functional>
+#include <span>
 
 enum class AgentState {
     IDLE,
@@ -20,21 +27,112 @@ enum class AgentAction {
     WAIT
 };
 
+// What the agent remembers of one decision; inputs themselves are not kept
+struct DecisionRecord {
+    AgentAction action;
+    MediaType mediaType;
+    bool success;
+    uint64_t inputSize;     // payload bytes, summed over a minibatch
+};
+
+// Immutable input bytes of an AgentContext. The bytes are held once by
+// whatever produced them (a vector, a string or a loaded file) and copies of
+// the payload share them, so copying a context never copies its input.
+//
+// Media too large to hold whole may instead be a stream, read in chunks of
+// the context's "chunk_size" parameter when trained on. A stream holds no
+// bytes and can be read only once, so its context is good for one action.
+class AgentPayload {
+public:
+    AgentPayload() = default;
+    explicit AgentPayload(std::vector<uint8_t> bytes);
+    explicit AgentPayload(std::string text);
+    explicit AgentPayload(utils::FileBuffer file);
+    explicit AgentPayload(std::shared_ptr<MediaReader> stream);
+
+    const uint8_t* data() const { return begin; }
+    // Bytes held, or those the stream expects to deliver
+    size_t size() const { return reader ? reader->sizeHint() : length; }
+    bool empty() const { return length == 0 && !reader; }
+    MediaReader* stream() const { return reader.get(); }
+    std::span<const uint8_t> bytes() const { return std::span<const uint8_t>(begin, length); }
+    std::string_view text() const { return std::string_view(reinterpret_cast<const char*>(begin), length); }
+
+private:
+    std::shared_ptr<const void> owner;
+    const uint8_t* begin = nullptr;
+    size_t length = 0;
+    std::shared_ptr<MediaReader> reader;
+};
+
 struct AgentContext {
     MediaType mediaType;
-    std::string input;
-    std::vector<uint8_t> binaryData;
+    AgentPayload payload;       // text for TEXT, raw media otherwise
     std::map<std::string, std::string> parameters;
 };
 
+// The "mode" parameter as far as the policy cares
+enum class ContextMode {
+    NONE,
+    TRAINING,
+    ANALYSIS,
+    OTHER
+};
+
+// What the policy reads from a context, parsed once per decision
+struct ContextFeatures {
+    MediaType mediaType;
+    bool hasInput;
+    uint64_t inputSize;
+    ContextMode mode;
+    const std::string* modeText;    // points into the context's parameters, nullptr without a mode
+
+    static ContextFeatures of(const AgentContext& context);
+};
+
+// Where an agent keeps what it has learned between runs. The snapshot holds
+// the action scores and the decision history; it is read when the agent is
+// constructed and rewritten every flushInterval decisions and on destruction.
+struct AgentStateOptions {
+    std::string path;               // snapshot file; empty keeps the state in memory only
+    size_t flushInterval = 256;     // decisions between flushes, 0 = only on destruction
+
+    // Snapshot kept under agents/ for the model's name, which unlike its id
+    // stays the same from one run to the next
+    static AgentStateOptions forModel(const AIModel& model);
+};
+
 class ModelAgent {
 public:
-    ModelAgent(std::shared_ptr<AIModel> model);
+    // Agents may share one pool of output buffers; each gets its own otherwise
+    ModelAgent(std::shared_ptr<AIModel> model, std::shared_ptr<BufferPool> bufferPool = nullptr,
+               AgentStateOptions persistence = AgentStateOptions());
+    // Flushes unsaved learning state when persistence is enabled
+    ~ModelAgent();
+
+    ModelAgent(const ModelAgent&) = delete;
+    ModelAgent& operator=(const ModelAgent&) = delete;
     
     // Core agent capabilities
     void processContext(const AgentContext& context);
+    // Minibatch form of processContext. Contexts are grouped by media type;
+    // one decision covers each group and TRAIN runs a single model update.
+    // Returns how many contexts were valid and handled; streamed payloads
+    // are not, as a minibatch holds all of its samples in memory.
+    size_t processBatch(std::span<const AgentContext> contexts);
     AgentAction decideNextAction(const AgentContext& context);
     void executeAction(AgentAction action, const AgentContext& context);
+
+    // The two halves of executeAction, for runtimes that run actions off the
+    // agent's thread. performAction runs against target, which may differ
+    // from the agent's model, and touches no agent state, so it may be
+    // called concurrently; recordOutcome feeds the result back.
+    bool performAction(AIModel& target, AgentAction action, const AgentContext& context) const;
+    void recordOutcome(AgentAction action, const AgentContext& context, bool success);
+    bool validateContext(const AgentContext& context) const;
+
+    std::shared_ptr<AIModel> getModel() const { return model; }
+    void setModel(std::shared_ptr<AIModel> newModel) { model = std::move(newModel); }
     
     // State management
     AgentState getState() const { return state; }
@@ -42,28 +140,65 @@ public:
     
     // Decision making
     double evaluateAction(AgentAction action, const AgentContext& context);
-    std::string getActionReasoning() const { return lastReasoning; }
+    // Built from the last decision the first time it is asked for
+    std::string getActionReasoning() const;
+    // Share of the remembered decisions that chose action and succeeded
+    double getSuccessRate(AgentAction action) const;
+    // Remembered decisions, oldest first
+    std::vector<DecisionRecord> getDecisionHistory() const;
     
     // Learning and adaptation
     void updateBehavior(const AgentContext& context, bool success);
     void learn(const AgentContext& context, const std::string& feedback);
 
+    // Writes the learning state to the snapshot file now; throws
+    // std::runtime_error if it cannot be written. Does nothing without a path.
+    void saveState();
+    // Whether construction picked up a snapshot from an earlier run
+    bool restoredState() const { return restored; }
+
 private:
     std::shared_ptr<AIModel> model;
+    std::shared_ptr<BufferPool> bufferPool;
     AgentState state;
-    std::string lastReasoning;
-    std::map<AgentAction, double> actionScores;
     
-    // Decision history for learning
-    struct Decision {
-        AgentAction action;
-        AgentContext context;
-        bool success;
+    // Policy: one score per action, indexed by AgentAction
+    static constexpr size_t ACTION_COUNT = 4;
+    std::array<double, ACTION_COUNT> actionScores;
+
+    // Inputs of the last decision's reasoning; the text is only formatted
+    // when getActionReasoning asks for it
+    struct Reasoning {
+        AgentAction action = AgentAction::WAIT;
+        MediaType mediaType = MediaType::TEXT;
+        uint64_t inputSize = 0;
+        double accuracy = 0.0;
+        bool hasMode = false;
+        std::string modeText;
     };
-    std::vector<Decision> decisionHistory;
+    Reasoning lastDecision;
+    mutable std::string lastReasoning;
+    mutable bool reasoningStale = false;
+    
+    // Decision history for learning: a fixed ring of compact records with
+    // running per-action success counts, so logging and scoring are O(1)
+    static constexpr size_t HISTORY_CAPACITY = 1000;
+    std::array<DecisionRecord, HISTORY_CAPACITY> decisionHistory;
+    size_t historyStart = 0;
+    size_t historySize = 0;
+    std::array<size_t, ACTION_COUNT> actionSuccesses{};
+
+    AgentStateOptions persistence;
+    size_t unsavedChanges = 0;
+    bool restored = false;
     
     // Helper methods
+    double scoreAction(AgentAction action, const ContextFeatures& features, double accuracy) const;
+    void setReasoning(std::string text);
     void logDecision(AgentAction action, const AgentContext& context, bool success);
-    std::string generateReasoning(AgentAction action, const AgentContext& context);
-    bool validateContext(const AgentContext& context) const;
+    void logDecision(const DecisionRecord& record);
+    void processGroup(std::span<const AgentContext* const> contexts);
+    bool loadState();
+    void noteChange();
+    std::string generateReasoning(const Reasoning& decision) const;
 };
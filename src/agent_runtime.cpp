@@ -0,0 +1,308 @@
+#include "agent_runtime.hpp"
+#include <optional>
+#include <stdexcept>
+
+namespace {
+    // Lets jobs submitted from a worker go to that worker's own lanes
+    thread_local const AgentRuntime* currentRuntime = nullptr;
+    thread_local std::size_t currentWorker = 0;
+}
+
+AgentRuntime::AgentRuntime(const AgentRuntimeConfig& config)
+    : config(config), bufferPool(std::make_shared<BufferPool>()) {
+    std::array<bool, 4> seen{};
+    for (std::size_t lane = 0; lane < this->config.laneOrder.size(); ++lane) {
+        auto action = static_cast<std::size_t>(this->config.laneOrder[lane]);
+        if (action >= seen.size() || seen[action]) {
+            throw std::invalid_argument("Lane order must list every agent action once");
+        }
+        seen[action] = true;
+        laneOf[action] = lane;
+    }
+
+    unsigned int count = this->config.workers;
+    if (count == 0) {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned int i = 0; i < count; ++i) {
+        queues.push_back(std::make_unique<Worker>());
+    }
+    for (unsigned int i = 0; i < count; ++i) {
+        threads.emplace_back(&AgentRuntime::workerLoop, this, i);
+    }
+}
+
+AgentRuntime::~AgentRuntime() {
+    waitIdle();
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void AgentRuntime::addModel(std::shared_ptr<AIModel> model) {
+    if (!model) {
+        throw std::invalid_argument("Cannot add a null model");
+    }
+    auto slot = std::make_shared<ModelSlot>();
+    slot->current = model;
+    slot->agent = std::make_unique<ModelAgent>(model, bufferPool);
+    std::unique_lock<std::shared_mutex> lock(registryMutex);
+    models[model->getId()] = std::move(slot);
+}
+
+std::shared_ptr<const AIModel> AgentRuntime::getModel(const std::string& modelId) const {
+    std::shared_ptr<ModelSlot> slot;
+    {
+        std::shared_lock<std::shared_mutex> lock(registryMutex);
+        auto it = models.find(modelId);
+        if (it == models.end()) {
+            return nullptr;
+        }
+        slot = it->second;
+    }
+    std::lock_guard<std::mutex> lock(slot->mutex);
+    return slot->current;
+}
+
+std::optional<AgentCancelled> AgentRuntime::Job::abortReason() const {
+    if (cancellation && cancellation->isCancelled()) {
+        return AgentCancelled(false);
+    }
+    if (deadline && std::chrono::steady_clock::now() > *deadline) {
+        return AgentCancelled(true);
+    }
+    return std::nullopt;
+}
+
+std::future<AgentOutcome> AgentRuntime::submit(const std::string& modelId, AgentContext context) {
+    return enqueueNew(modelId, std::move(context), AgentJobOptions());
+}
+
+std::future<AgentOutcome> AgentRuntime::submit(const std::string& modelId, AgentContext context,
+                                               AgentAction action) {
+    AgentJobOptions options;
+    options.action = action;
+    return enqueueNew(modelId, std::move(context), options);
+}
+
+std::future<AgentOutcome> AgentRuntime::submit(const std::string& modelId, AgentContext context,
+                                               const AgentJobOptions& options) {
+    return enqueueNew(modelId, std::move(context), options);
+}
+
+std::future<AgentOutcome> AgentRuntime::enqueueNew(const std::string& modelId, AgentContext context,
+                                                   const AgentJobOptions& options) {
+    std::promise<AgentOutcome> result;
+    auto future = result.get_future();
+
+    std::shared_ptr<ModelSlot> slot;
+    {
+        std::shared_lock<std::shared_mutex> lock(registryMutex);
+        auto it = models.find(modelId);
+        if (it != models.end()) {
+            slot = it->second;
+        }
+    }
+    if (!slot) {
+        result.set_exception(std::make_exception_ptr(std::invalid_argument("Unknown model: " + modelId)));
+        return future;
+    }
+
+    AgentAction chosen;
+    {
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        if (!slot->agent->validateContext(context)) {
+            slot->agent->setState(AgentState::ERROR);
+            result.set_exception(std::make_exception_ptr(
+                std::invalid_argument("Invalid context for model " + modelId)));
+            return future;
+        }
+        chosen = options.action ? *options.action : slot->agent->decideNextAction(context);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        inFlight++;
+    }
+    submitted++;
+    enqueue(Job{std::move(slot), std::move(context), chosen, std::move(result),
+                options.cancellation, options.deadline});
+    return future;
+}
+
+void AgentRuntime::enqueue(Job job) {
+    std::size_t target = currentRuntime == this ? currentWorker : nextQueue++ % queues.size();
+    {
+        Worker& worker = *queues[target];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.lanes[laneOf[static_cast<std::size_t>(job.action)]].push_back(std::move(job));
+    }
+    queued++;
+    {
+        // Pairs with the predicate check in workerLoop so no wakeup is lost
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wakeup.notify_one();
+}
+
+bool AgentRuntime::takeJob(std::size_t self, Job& job) {
+    if (queued.load() == 0) {
+        return false;
+    }
+    // Higher lanes anywhere win over lower lanes of this worker. Owners take
+    // the oldest job of a lane, thieves the newest.
+    std::size_t count = queues.size();
+    for (std::size_t lane = 0; lane < 4; ++lane) {
+        for (std::size_t k = 0; k < count; ++k) {
+            Worker& worker = *queues[(self + k) % count];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            auto& jobs = worker.lanes[lane];
+            if (jobs.empty()) {
+                continue;
+            }
+            if (k == 0) {
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            } else {
+                job = std::move(jobs.back());
+                jobs.pop_back();
+                steals++;
+            }
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void AgentRuntime::workerLoop(std::size_t self) {
+    currentRuntime = this;
+    currentWorker = self;
+    while (true) {
+        Job job;
+        if (takeJob(self, job)) {
+            run(std::move(job));
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeup.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+void AgentRuntime::run(Job job) {
+    ModelSlot& slot = *job.slot;
+    bool training = job.action == AgentAction::TRAIN;
+    std::shared_ptr<AIModel> model;
+    {
+        std::lock_guard<std::mutex> lock(slot.mutex);
+        if (training && !job.holdsStrand) {
+            if (slot.training) {
+                // The running TRAIN hands this job back when it finishes
+                slot.parkedTrains.push_back(std::move(job));
+                return;
+            }
+            slot.training = true;
+        }
+        model = slot.current;
+    }
+
+    // The agent is only read here; its bookkeeping happens under the slot lock
+    std::optional<AgentCancelled> aborted = job.abortReason();
+    bool ran = !aborted;
+    bool success = false;
+    std::exception_ptr error;
+    if (ran) {
+        try {
+            if (training) {
+                auto next = model->clone();
+                success = slot.agent->performAction(*next, job.action, job.context);
+                // Checked before publishing so a late step leaves the model as it was
+                aborted = job.abortReason();
+                if (success && !aborted) {
+                    model = std::move(next);
+                }
+            } else {
+                success = slot.agent->performAction(*model, job.action, job.context);
+                aborted = job.abortReason();
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+
+    std::optional<Job> handoff;
+    {
+        std::lock_guard<std::mutex> lock(slot.mutex);
+        if (training) {
+            if (success && !aborted) {
+                slot.current = model;
+                slot.agent->setModel(model);
+            }
+            if (!slot.parkedTrains.empty()) {
+                handoff.emplace(std::move(slot.parkedTrains.front()));
+                slot.parkedTrains.pop_front();
+                handoff->holdsStrand = true;
+            } else {
+                slot.training = false;
+            }
+        }
+        // Results nobody waits for any more do not teach the agent
+        if (ran && !aborted) {
+            slot.agent->recordOutcome(job.action, job.context, success);
+        }
+    }
+    if (handoff) {
+        enqueue(std::move(*handoff));
+    }
+
+    if (ran) {
+        executed++;
+        executedByAction[static_cast<std::size_t>(job.action)]++;
+    }
+    if (aborted && !error) {
+        cancelled++;
+        if (aborted->deadlineExceeded()) {
+            deadlineMisses++;
+        }
+        error = std::make_exception_ptr(*aborted);
+    }
+    if (error) {
+        job.result.set_exception(error);
+    } else {
+        job.result.set_value(AgentOutcome{job.action, success, model->getVersion()});
+    }
+    finish();
+}
+
+void AgentRuntime::finish() {
+    std::lock_guard<std::mutex> lock(idleMutex);
+    if (--inFlight == 0) {
+        idle.notify_all();
+    }
+}
+
+void AgentRuntime::waitIdle() {
+    std::unique_lock<std::mutex> lock(idleMutex);
+    idle.wait(lock, [this] { return inFlight == 0; });
+}
+
+AgentRuntimeStats AgentRuntime::getStats() const {
+    AgentRuntimeStats stats;
+    stats.submitted = submitted.load();
+    stats.executed = executed.load();
+    stats.steals = steals.load();
+    stats.cancelled = cancelled.load();
+    stats.deadlineMisses = deadlineMisses.load();
+    for (std::size_t i = 0; i < stats.byAction.size(); ++i) {
+        stats.byAction[i] = executedByAction[i].load();
+    }
+    return stats;
+}
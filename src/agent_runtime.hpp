@@ -0,0 +1,183 @@
+#pragma once
+#include "agent.hpp"
+#include "buffer_pool.hpp"
+#include "model.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct AgentRuntimeConfig {
+    unsigned int workers = 0;           // 0 = one per core
+    // Lanes are drained in this order; every action appears exactly once
+    std::array<AgentAction, 4> laneOrder{AgentAction::PROCESS, AgentAction::ANALYZE,
+                                         AgentAction::TRAIN, AgentAction::WAIT};
+};
+
+struct AgentOutcome {
+    AgentAction action;
+    bool success = false;
+    unsigned int modelVersion = 0;      // version the action ran against or produced
+};
+
+// Cooperative cancellation: copies share one flag, so a caller keeps a copy
+// and cancels every job it handed the token to
+class CancellationToken {
+public:
+    CancellationToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+    void cancel() { flag->store(true); }
+    bool isCancelled() const { return flag->load(); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag;
+};
+
+// Thrown through the future of a job that was cancelled or missed its deadline
+class AgentCancelled : public std::runtime_error {
+public:
+    explicit AgentCancelled(bool deadline)
+        : std::runtime_error(deadline ? "Agent job missed its deadline" : "Agent job cancelled"),
+          deadline(deadline) {}
+    bool deadlineExceeded() const { return deadline; }
+
+private:
+    bool deadline;
+};
+
+struct AgentJobOptions {
+    std::optional<AgentAction> action;      // unset lets the agent decide
+    std::optional<CancellationToken> cancellation;
+    // A job that has not finished by then fails with AgentCancelled
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+};
+
+struct AgentRuntimeStats {
+    std::uint64_t submitted = 0;
+    std::uint64_t executed = 0;
+    std::uint64_t cancelled = 0;        // includes missed deadlines
+    std::uint64_t deadlineMisses = 0;
+    std::uint64_t steals = 0;           // jobs taken from another worker's lanes
+    std::array<std::uint64_t, 4> byAction{};    // executed, indexed by AgentAction
+};
+
+// Runs AgentContext jobs for many models on a work-stealing pool. Each
+// worker keeps one deque per priority lane; an idle worker drains the
+// highest lane it can find, its own first, stealing from the others before
+// it settles for a lower lane.
+//
+// Every model gets one ModelAgent, which decides the action when a job is
+// submitted. TRAIN jobs of a model run one at a time: a TRAIN that arrives
+// while another is running is parked on the model and picked up by that
+// job's worker when it finishes. Training works on a copy-on-write clone
+// that replaces the model once the step completes, so PROCESS and ANALYZE
+// jobs never wait for training and run concurrently against the version
+// current when they start.
+//
+// Jobs can carry a cancellation token and a deadline. Both are checked when
+// a worker picks the job up and again when it completes; a TRAIN step that
+// is cancelled or late by then is discarded and leaves the model unchanged.
+class AgentRuntime {
+public:
+    explicit AgentRuntime(const AgentRuntimeConfig& config = AgentRuntimeConfig());
+    // Finishes every submitted job, then stops the workers
+    ~AgentRuntime();
+
+    AgentRuntime(const AgentRuntime&) = delete;
+    AgentRuntime& operator=(const AgentRuntime&) = delete;
+
+    // Registers a model under its id; the runtime owns its updates from now on
+    void addModel(std::shared_ptr<AIModel> model);
+    // Current version of a model, nullptr if unknown
+    std::shared_ptr<const AIModel> getModel(const std::string& modelId) const;
+
+    // Lets the model's agent choose the action. The future throws
+    // std::invalid_argument for an unknown model or an invalid context.
+    std::future<AgentOutcome> submit(const std::string& modelId, AgentContext context);
+    // Runs the given action instead of asking the agent
+    std::future<AgentOutcome> submit(const std::string& modelId, AgentContext context,
+                                     AgentAction action);
+    std::future<AgentOutcome> submit(const std::string& modelId, AgentContext context,
+                                     const AgentJobOptions& options);
+
+    // Blocks until every submitted job has finished
+    void waitIdle();
+    unsigned int workerCount() const { return static_cast<unsigned int>(threads.size()); }
+    AgentRuntimeStats getStats() const;
+
+private:
+    struct ModelSlot;
+
+    struct Job {
+        std::shared_ptr<ModelSlot> slot;
+        AgentContext context;
+        AgentAction action;
+        std::promise<AgentOutcome> result;
+        std::optional<CancellationToken> cancellation;
+        std::optional<std::chrono::steady_clock::time_point> deadline;
+        bool holdsStrand = false;       // a TRAIN handed over by the previous one
+
+        // Why the job should not run or publish any more, if it should not
+        std::optional<AgentCancelled> abortReason() const;
+    };
+
+    // Agent, current model and TRAIN strand of one model, all under mutex
+    struct ModelSlot {
+        std::mutex mutex;
+        std::shared_ptr<AIModel> current;
+        std::unique_ptr<ModelAgent> agent;
+        bool training = false;
+        std::deque<Job> parkedTrains;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::array<std::deque<Job>, 4> lanes;
+    };
+
+    std::future<AgentOutcome> enqueueNew(const std::string& modelId, AgentContext context,
+                                         const AgentJobOptions& options);
+    void enqueue(Job job);
+    bool takeJob(std::size_t self, Job& job);
+    void workerLoop(std::size_t self);
+    void run(Job job);
+    void finish();
+
+    AgentRuntimeConfig config;
+    std::array<std::size_t, 4> laneOf{};    // lane index by AgentAction
+    std::shared_ptr<BufferPool> bufferPool; // shared by all agents
+
+    mutable std::shared_mutex registryMutex;
+    std::unordered_map<std::string, std::shared_ptr<ModelSlot>> models;
+
+    std::vector<std::unique_ptr<Worker>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> nextQueue{0};
+    std::atomic<std::size_t> queued{0};
+    std::mutex sleepMutex;
+    std::condition_variable wakeup;
+    bool stopping = false;
+
+    std::mutex idleMutex;
+    std::condition_variable idle;
+    std::size_t inFlight = 0;
+
+    std::atomic<std::uint64_t> submitted{0};
+    std::atomic<std::uint64_t> executed{0};
+    std::atomic<std::uint64_t> steals{0};
+    std::atomic<std::uint64_t> cancelled{0};
+    std::atomic<std::uint64_t> deadlineMisses{0};
+    std::array<std::atomic<std::uint64_t>, 4> executedByAction{};
+};
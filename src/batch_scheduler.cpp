@@ -0,0 +1,122 @@
+#include "batch_scheduler.hpp"
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+
+BatchScheduler::BatchScheduler(std::shared_ptr<const AIModel> model, MediaType type,
+                               const BatchConfig& config)
+    : model(std::move(model)), type(type), config(config) {
+    if (this->config.maxBatchSize == 0) {
+        this->config.maxBatchSize = 1;
+    }
+    // Fail at construction rather than on every request
+    if (!this->model || !this->model->supportsMediaType(type)) {
+        throw std::runtime_error("Model does not support this media type");
+    }
+    worker = std::thread(&BatchScheduler::run, this);
+}
+
+BatchScheduler::~BatchScheduler() {
+    shutdown();
+}
+
+std::future<std::vector<std::uint8_t>> BatchScheduler::submit(std::vector<std::uint8_t> input) {
+    Request request;
+    request.input = std::move(input);
+    request.enqueued = std::chrono::steady_clock::now();
+    auto future = request.result.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            throw std::runtime_error("Batch scheduler is shut down");
+        }
+        pending.push_back(std::move(request));
+        stats.requests++;
+    }
+    wakeup.notify_one();
+    return future;
+}
+
+void BatchScheduler::setModel(std::shared_ptr<const AIModel> next) {
+    if (!next || !next->supportsMediaType(type)) {
+        throw std::runtime_error("Model does not support this media type");
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    model = std::move(next);
+}
+
+void BatchScheduler::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeup.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+BatchScheduler::Stats BatchScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void BatchScheduler::run() {
+    std::vector<Request> batch;
+    batch.reserve(config.maxBatchSize);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wakeup.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty()) {
+            return;
+        }
+
+        // Give the batch until the oldest request's deadline to fill up
+        auto deadline = pending.front().enqueued + config.maxLatency;
+        wakeup.wait_until(lock, deadline, [this] {
+            return stopping || pending.size() >= config.maxBatchSize;
+        });
+
+        std::size_t count = std::min(config.maxBatchSize, pending.size());
+        for (std::size_t i = 0; i < count; ++i) {
+            batch.push_back(std::move(pending.front()));
+            pending.pop_front();
+        }
+        stats.batches++;
+        stats.largestBatch = std::max(stats.largestBatch, count);
+        std::shared_ptr<const AIModel> current = model;
+
+        lock.unlock();
+        dispatch(*current, batch);
+        batch.clear();
+        lock.lock();
+    }
+}
+
+void BatchScheduler::dispatch(const AIModel& current, std::vector<Request>& batch) {
+    std::vector<std::span<const std::uint8_t>> inputs;
+    inputs.reserve(batch.size());
+    for (const auto& request : batch) {
+        inputs.emplace_back(request.input);
+    }
+    std::vector<std::size_t> lengths(batch.size());
+
+    std::optional<BufferPool::Lease> output;
+    try {
+        output.emplace(outputPool.acquire(current.batchOutputSize(type, inputs)));
+        current.processBatch(type, inputs, output->span(), lengths);
+    } catch (...) {
+        for (auto& request : batch) {
+            request.result.set_exception(std::current_exception());
+        }
+        return;
+    }
+
+    const std::uint8_t* cursor = output->data();
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        batch[i].result.set_value(std::vector<std::uint8_t>(cursor, cursor + lengths[i]));
+        cursor += lengths[i];
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "model.hpp"
+#include "buffer_pool.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct BatchConfig {
+    std::size_t maxBatchSize = 32;
+    // Longest a request waits for its batch to fill before it is dispatched
+    std::chrono::microseconds maxLatency{2000};
+};
+
+// Dynamic batching in front of AIModel::processBatch. Requests for one media
+// type are queued and dispatched together once maxBatchSize requests are
+// waiting or the oldest request reaches its maxLatency deadline.
+class BatchScheduler {
+public:
+    BatchScheduler(std::shared_ptr<const AIModel> model, MediaType type,
+                   const BatchConfig& config = BatchConfig());
+    ~BatchScheduler();
+
+    BatchScheduler(const BatchScheduler&) = delete;
+    BatchScheduler& operator=(const BatchScheduler&) = delete;
+
+    std::future<std::vector<std::uint8_t>> submit(std::vector<std::uint8_t> input);
+    // Batches dispatched from now on run against next; a batch already
+    // running finishes on the model it started with
+    void setModel(std::shared_ptr<const AIModel> next);
+    // Dispatches everything still queued and stops the batching thread
+    void shutdown();
+
+    struct Stats {
+        std::size_t requests = 0;
+        std::size_t batches = 0;
+        std::size_t largestBatch = 0;
+    };
+    Stats getStats() const;
+
+private:
+    struct Request {
+        std::vector<std::uint8_t> input;
+        std::promise<std::vector<std::uint8_t>> result;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    void run();
+    void dispatch(const AIModel& current, std::vector<Request>& batch);
+
+    std::shared_ptr<const AIModel> model;
+    MediaType type;
+    BatchConfig config;
+    BufferPool outputPool;
+
+    mutable std::mutex mutex;
+    std::condition_variable wakeup;
+    std::deque<Request> pending;
+    bool stopping = false;
+    Stats stats;
+    std::thread worker;
+};
@@ -0,0 +1,177 @@
+#include "batch_trainer.hpp"
+#include "bounded_queue.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <iostream>
+#include <semaphore>
+#include <thread>
+
+namespace {
+    struct LoadedFile {
+        std::size_t index;
+        utils::FileBuffer data;
+        std::string error;
+    };
+
+    struct PreparedFile {
+        std::size_t index;
+        AgentContext context;
+        std::string error;
+    };
+
+    unsigned int workerCount(unsigned int requested) {
+        if (requested) return requested;
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+BatchTrainer::BatchTrainer(std::shared_ptr<AIModel> model, MediaType type,
+                           const BatchTrainingOptions& options)
+    : model(model), type(type), options(options), agent(model) {
+    if (this->options.queueDepth == 0) {
+        this->options.queueDepth = 1;
+    }
+    if (this->options.batchSize == 0) {
+        this->options.batchSize = 1;
+    }
+}
+
+std::vector<std::string> BatchTrainer::listFiles(const std::string& directory) {
+    std::vector<std::string> files;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.is_regular_file()) {
+            files.push_back(entry.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+BatchTrainingResult BatchTrainer::run(const std::string& directory) {
+    const std::vector<std::string> files = listFiles(directory);
+    BatchTrainingResult result;
+    result.files = files.size();
+    if (files.empty()) {
+        return result;
+    }
+    // Every pass re-reads the directory so memory stays bounded; sample i
+    // of the run is file i % files.size()
+    const std::size_t total = files.size() * std::max(1u, options.passes);
+
+    model->setComputeThreads(options.trainThreads);
+
+    const unsigned int readerCount = workerCount(options.readers);
+    const unsigned int prepareCount = workerCount(options.prepareWorkers);
+    BoundedQueue<LoadedFile> loaded(options.queueDepth);
+    BoundedQueue<PreparedFile> prepared(options.queueDepth);
+
+    // One permit per file in flight; a permit is returned once its file has
+    // joined a batch, so readers never run more than queueDepth files ahead
+    std::counting_semaphore<> window(static_cast<std::ptrdiff_t>(options.queueDepth));
+    std::atomic<std::size_t> nextFile{0};
+    std::atomic<bool> aborted{false};
+    std::atomic<unsigned int> activeReaders{readerCount};
+    std::atomic<unsigned int> activePreparers{prepareCount};
+
+    auto readStage = [&] {
+        while (true) {
+            window.acquire();
+            std::size_t index = nextFile++;
+            if (aborted || index >= total) {
+                window.release();
+                break;
+            }
+            LoadedFile item{index, {}, {}};
+            try {
+                // Read rather than mapped: a mapping would defer the disk I/O
+                // to page faults on the training thread instead of this one
+                item.data = utils::loadFile(files[index % files.size()], utils::LoadMode::READ);
+            } catch (const std::exception& e) {
+                item.error = e.what();
+            }
+            if (!loaded.push(std::move(item))) break;
+        }
+        if (--activeReaders == 0) loaded.close();
+    };
+
+    auto prepareStage = [&] {
+        while (auto item = loaded.pop()) {
+            PreparedFile out{item->index, {}, std::move(item->error)};
+            if (out.error.empty()) {
+                // The loaded file becomes the payload as is
+                out.context.mediaType = type;
+                out.context.payload = AgentPayload(std::move(item->data));
+                out.context.parameters = options.parameters;
+            }
+            if (!prepared.push(std::move(out))) break;
+        }
+        if (--activePreparers == 0) prepared.close();
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(readerCount + prepareCount);
+    for (unsigned int i = 0; i < readerCount; ++i) workers.emplace_back(readStage);
+    for (unsigned int i = 0; i < prepareCount; ++i) workers.emplace_back(prepareStage);
+
+    auto stopWorkers = [&] {
+        aborted = true;
+        loaded.close();
+        prepared.close();
+        window.release(static_cast<std::ptrdiff_t>(readerCount));
+        for (auto& worker : workers) worker.join();
+    };
+
+    try {
+        std::vector<AgentContext> batch;
+        batch.reserve(options.batchSize);
+        auto flushBatch = [&](std::size_t applied) {
+            if (!batch.empty()) {
+                std::size_t handled = agent.processBatch(batch);
+                result.trained += handled;
+                result.failed += batch.size() - handled;
+                result.batches++;
+                batch.clear();
+            }
+            if (options.onProgress) {
+                options.onProgress(applied, total);
+            }
+        };
+
+        // Files finish preparing out of order; hold them until their turn
+        std::map<std::size_t, PreparedFile> pending;
+        std::size_t nextToApply = 0;
+        while (nextToApply < total) {
+            auto item = prepared.pop();
+            if (!item) break;
+            std::size_t index = item->index;
+            pending.emplace(index, std::move(*item));
+
+            for (auto it = pending.find(nextToApply); it != pending.end();
+                 it = pending.find(nextToApply)) {
+                if (it->second.error.empty()) {
+                    batch.push_back(std::move(it->second.context));
+                } else {
+                    std::cerr << "Error processing file "
+                              << std::filesystem::path(files[nextToApply % files.size()]).filename()
+                              << ": " << it->second.error << std::endl;
+                    result.failed++;
+                }
+                pending.erase(it);
+                window.release();
+                nextToApply++;
+                // Batches never straddle a pass boundary
+                if (batch.size() == options.batchSize || nextToApply % files.size() == 0) {
+                    flushBatch(nextToApply);
+                }
+            }
+        }
+    } catch (...) {
+        stopWorkers();
+        throw;
+    }
+
+    for (auto& worker : workers) worker.join();
+    return result;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "model.hpp"
+#include "agent.hpp"
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct BatchTrainingOptions {
+    unsigned int readers = 2;           // threads prefetching files from disk
+    unsigned int prepareWorkers = 0;    // threads building agent contexts; 0 = one per core
+    unsigned int trainThreads = 0;      // kernel threads per weight update; 0 = one per core
+    std::size_t queueDepth = 64;        // most files in flight between disk and the batch
+    std::size_t batchSize = 32;         // files folded into one weight update
+    unsigned int passes = 1;            // times the whole directory is trained on
+    std::map<std::string, std::string> parameters;  // attached to every context
+
+    // Called on the training thread after each batch with the number of
+    // files applied so far out of files * passes
+    std::function<void(std::size_t done, std::size_t total)> onProgress;
+};
+
+struct BatchTrainingResult {
+    std::size_t files = 0;
+    std::size_t trained = 0;    // samples the agent accepted over all passes
+    std::size_t failed = 0;     // unreadable files and rejected samples
+    std::size_t batches = 0;
+};
+
+// Pipelined directory training. Reader threads prefetch files into a bounded
+// queue, prepare workers turn them into agent contexts, and the calling thread
+// groups them into minibatches for the agent. Files are batched in sorted path
+// order whatever order the stages finish in, so a run is reproducible; at most
+// queueDepth + batchSize files are held in memory at once.
+class BatchTrainer {
+public:
+    BatchTrainer(std::shared_ptr<AIModel> model, MediaType type,
+                 const BatchTrainingOptions& options = BatchTrainingOptions());
+
+    BatchTrainingResult run(const std::string& directory);
+
+    const ModelAgent& getAgent() const { return agent; }
+
+private:
+    std::shared_ptr<AIModel> model;
+    MediaType type;
+    BatchTrainingOptions options;
+    ModelAgent agent;
+
+    static std::vector<std::string> listFiles(const std::string& directory);
+};
@@ -0,0 +1,70 @@
+#include "buffer_pool.hpp"
+#include <utility>
+
+BufferPool::Lease::Lease(BufferPool* pool, std::vector<std::uint8_t> buffer)
+    : pool(pool), buffer(std::move(buffer)) {
+}
+
+BufferPool::Lease::Lease(Lease&& other) noexcept
+    : pool(other.pool), buffer(std::move(other.buffer)) {
+    other.pool = nullptr;
+}
+
+BufferPool::Lease& BufferPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        if (pool) pool->release(std::move(buffer));
+        pool = other.pool;
+        buffer = std::move(other.buffer);
+        other.pool = nullptr;
+    }
+    return *this;
+}
+
+BufferPool::Lease::~Lease() {
+    if (pool) pool->release(std::move(buffer));
+}
+
+BufferPool::BufferPool(std::size_t maxPooled)
+    : maxPooled(maxPooled) {
+    // Returning a buffer must never allocate either
+    freeBuffers.reserve(maxPooled);
+}
+
+BufferPool::Lease BufferPool::acquire(std::size_t size) {
+    std::vector<std::uint8_t> buffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Smallest idle buffer that already has the capacity
+        std::size_t best = freeBuffers.size();
+        for (std::size_t i = 0; i < freeBuffers.size(); ++i) {
+            if (freeBuffers[i].capacity() >= size &&
+                (best == freeBuffers.size() || freeBuffers[i].capacity() < freeBuffers[best].capacity())) {
+                best = i;
+            }
+        }
+        if (best != freeBuffers.size()) {
+            buffer = std::move(freeBuffers[best]);
+            freeBuffers[best] = std::move(freeBuffers.back());
+            freeBuffers.pop_back();
+            stats.hits++;
+        } else {
+            stats.misses++;
+        }
+        stats.pooled = freeBuffers.size();
+    }
+    buffer.resize(size);
+    return Lease(this, std::move(buffer));
+}
+
+BufferPool::Stats BufferPool::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void BufferPool::release(std::vector<std::uint8_t>&& buffer) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (freeBuffers.size() < maxPooled) {
+        freeBuffers.push_back(std::move(buffer));
+    }
+    stats.pooled = freeBuffers.size();
+}
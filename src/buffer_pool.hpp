@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+
+// Recycles byte buffers between requests. A Lease hands out a buffer of the
+// requested size and returns it to the pool when destroyed, so once the pool
+// has warmed up to the working-set sizes no request allocates.
+class BufferPool {
+public:
+    class Lease {
+    public:
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease();
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        std::uint8_t* data() { return buffer.data(); }
+        std::size_t size() const { return buffer.size(); }
+        std::span<std::uint8_t> span() { return std::span<std::uint8_t>(buffer); }
+        void resize(std::size_t newSize) { buffer.resize(newSize); }
+
+    private:
+        friend class BufferPool;
+        Lease(BufferPool* pool, std::vector<std::uint8_t> buffer);
+
+        BufferPool* pool;
+        std::vector<std::uint8_t> buffer;
+    };
+
+    struct Stats {
+        std::size_t hits = 0;       // served from a pooled buffer without allocating
+        std::size_t misses = 0;     // needed a new or larger allocation
+        std::size_t pooled = 0;     // buffers currently idle in the pool
+    };
+
+    explicit BufferPool(std::size_t maxPooled = 64);
+
+    Lease acquire(std::size_t size);
+    Stats getStats() const;
+
+private:
+    void release(std::vector<std::uint8_t>&& buffer);
+
+    mutable std::mutex mutex;
+    std::vector<std::vector<std::uint8_t>> freeBuffers;
+    std::size_t maxPooled;
+    Stats stats;
+};
@@ -0,0 +1,229 @@
+#include "ingest.hpp"
+#include "bounded_queue.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace {
+    const std::size_t READ_CHUNK = 64 * 1024;
+
+    std::uint32_t decodeLength(const char* bytes) {
+        const auto* b = reinterpret_cast<const unsigned char*>(bytes);
+        return static_cast<std::uint32_t>(b[0]) | (static_cast<std::uint32_t>(b[1]) << 8) |
+               (static_cast<std::uint32_t>(b[2]) << 16) | (static_cast<std::uint32_t>(b[3]) << 24);
+    }
+
+    void appendLength(std::string& out, std::uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+}
+
+DocumentStreamReader::DocumentStreamReader(int fd, int cancelFd)
+    : fd(fd), cancelFd(cancelFd), buffer(READ_CHUNK) {
+}
+
+std::size_t DocumentStreamReader::readSome(char* out, std::size_t length) {
+    while (true) {
+        if (cancelFd >= 0) {
+            pollfd fds[2] = {{fd, POLLIN, 0}, {cancelFd, POLLIN, 0}};
+            if (::poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("Failed to poll document stream: ") + std::strerror(errno));
+            }
+            if (fds[1].revents != 0) {
+                throw std::runtime_error("Document stream cancelled");
+            }
+        }
+        ssize_t n = ::read(fd, out, length);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("Failed to read document stream: ") + std::strerror(errno));
+        }
+        return static_cast<std::size_t>(n);
+    }
+}
+
+bool DocumentStreamReader::fill(std::size_t needed) {
+    while (end - begin < needed && !eof) {
+        if (begin > 0) {
+            std::copy(buffer.begin() + begin, buffer.begin() + end, buffer.begin());
+            end -= begin;
+            begin = 0;
+        }
+        if (buffer.size() - end < READ_CHUNK) {
+            buffer.resize(std::max(buffer.size() * 2, end + READ_CHUNK));
+        }
+        std::size_t n = readSome(buffer.data() + end, buffer.size() - end);
+        if (n == 0) {
+            eof = true;
+        }
+        end += n;
+    }
+    return end - begin >= needed;
+}
+
+void DocumentStreamReader::take(char* out, std::size_t length) {
+    std::copy_n(buffer.data() + begin, length, out);
+    begin += length;
+}
+
+bool DocumentStreamReader::next(IngestDocument& document) {
+    if (!fill(8)) {
+        if (end == begin) return false;
+        throw std::runtime_error("Truncated document record header");
+    }
+    std::uint32_t sourceLength = decodeLength(buffer.data() + begin);
+    std::uint32_t textLength = decodeLength(buffer.data() + begin + 4);
+    if (sourceLength > MAX_SOURCE_LENGTH || textLength > MAX_TEXT_LENGTH) {
+        throw std::runtime_error("Document record exceeds size limits");
+    }
+    begin += 8;
+
+    if (!fill(sourceLength)) {
+        throw std::runtime_error("Truncated document record");
+    }
+    document.source.resize(sourceLength);
+    take(document.source.data(), sourceLength);
+
+    // Large bodies go straight from the descriptor into the document
+    document.text.resize(textLength);
+    std::size_t buffered = std::min<std::size_t>(textLength, end - begin);
+    take(document.text.data(), buffered);
+    std::size_t filled = buffered;
+    while (filled < textLength) {
+        std::size_t n = readSome(document.text.data() + filled, textLength - filled);
+        if (n == 0) {
+            throw std::runtime_error("Truncated document record");
+        }
+        filled += n;
+    }
+    return true;
+}
+
+void encodeDocument(const IngestDocument& document, std::string& out) {
+    appendLength(out, static_cast<std::uint32_t>(document.source.size()));
+    appendLength(out, static_cast<std::uint32_t>(document.text.size()));
+    out += document.source;
+    out += document.text;
+}
+
+CrawlerProcess::CrawlerProcess(const std::string& url, const std::string& goal) {
+    int fds[2];
+    if (::pipe2(fds, O_CLOEXEC) != 0) {
+        throw std::runtime_error(std::string("Failed to create crawler pipe: ") + std::strerror(errno));
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+
+    // Arguments are passed as-is; no shell ever sees the URL
+    std::vector<std::string> args = {"python3", "src/web_crawler.py", "--stream", url};
+    if (!goal.empty()) args.push_back(goal);
+    std::vector<char*> argv;
+    for (auto& arg : args) argv.push_back(arg.data());
+    argv.push_back(nullptr);
+
+    int rc = ::posix_spawnp(&pid, "python3", &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(fds[1]);
+    if (rc != 0) {
+        ::close(fds[0]);
+        throw std::runtime_error(std::string("Failed to start crawler: ") + std::strerror(rc));
+    }
+    readFd = fds[0];
+}
+
+CrawlerProcess::~CrawlerProcess() {
+    if (pid > 0) {
+        // Only reached on an error path; the crawler may be mid-fetch and
+        // would otherwise run on until it next writes
+        ::kill(pid, SIGTERM);
+        wait();
+    }
+}
+
+int CrawlerProcess::wait() {
+    if (readFd >= 0) {
+        ::close(readFd);
+        readFd = -1;
+    }
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    pid = -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+IngestionPipeline::IngestionPipeline(ModelAgent& agent, const IngestOptions& options)
+    : agent(agent), options(options) {
+}
+
+IngestStats IngestionPipeline::run(int fd) {
+    BoundedQueue<IngestDocument> documents(options.queueDepth);
+    std::exception_ptr readError;
+
+    // Written to when the agent fails, to wake a reader blocked on fd
+    int cancel[2];
+    if (::pipe2(cancel, O_CLOEXEC) != 0) {
+        throw std::runtime_error(std::string("Failed to create cancel pipe: ") + std::strerror(errno));
+    }
+
+    std::thread reader([&] {
+        try {
+            DocumentStreamReader stream(fd, cancel[0]);
+            IngestDocument document;
+            while (stream.next(document)) {
+                if (!documents.push(std::move(document))) break;
+                document = IngestDocument();
+            }
+        } catch (...) {
+            readError = std::current_exception();
+        }
+        documents.close();
+    });
+
+    IngestStats stats;
+    try {
+        while (auto document = documents.pop()) {
+            AgentContext context;
+            context.mediaType = MediaType::TEXT;
+            context.parameters = options.parameters;
+            context.parameters["source"] = document->source;
+            stats.bytes += document->text.size();
+            context.payload = AgentPayload(std::move(document->text));
+            agent.processContext(context);
+            stats.documents++;
+        }
+    } catch (...) {
+        documents.close();
+        char stop = 1;
+        while (::write(cancel[1], &stop, 1) < 0 && errno == EINTR) {
+        }
+        reader.join();
+        ::close(cancel[0]);
+        ::close(cancel[1]);
+        throw;
+    }
+
+    reader.join();
+    ::close(cancel[0]);
+    ::close(cancel[1]);
+    if (readError) {
+        std::rethrow_exception(readError);
+    }
+    return stats;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "agent.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// A document produced by the crawler or any other ingestion source
+struct IngestDocument {
+    std::string source;     // URL or other origin of the text
+    std::string text;
+};
+
+// Reads length-prefixed document records from a file descriptor. Each record
+// is two little-endian uint32 lengths (source, text) followed by the source
+// and text bytes; the stream ends at EOF on a record boundary.
+class DocumentStreamReader {
+public:
+    static constexpr std::uint32_t MAX_SOURCE_LENGTH = 64 * 1024;
+    static constexpr std::uint32_t MAX_TEXT_LENGTH = 256 * 1024 * 1024;
+
+    // Once cancelFd becomes readable, a read that would block throws instead
+    explicit DocumentStreamReader(int fd, int cancelFd = -1);
+
+    // Returns false at the end of the stream; throws std::runtime_error on
+    // I/O errors, on truncated or oversized records and on cancellation
+    bool next(IngestDocument& document);
+
+private:
+    bool fill(std::size_t needed);
+    void take(char* out, std::size_t length);
+    std::size_t readSome(char* out, std::size_t length);
+
+    int fd;
+    int cancelFd;
+    std::vector<char> buffer;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    bool eof = false;
+};
+
+// Appends one record in the DocumentStreamReader format
+void encodeDocument(const IngestDocument& document, std::string& out);
+
+// Runs the crawler with its stdout connected to a pipe, without a shell
+class CrawlerProcess {
+public:
+    CrawlerProcess(const std::string& url, const std::string& goal);
+    // A crawler that was never waited for is terminated, then reaped
+    ~CrawlerProcess();
+
+    CrawlerProcess(const CrawlerProcess&) = delete;
+    CrawlerProcess& operator=(const CrawlerProcess&) = delete;
+
+    int output() const { return readFd; }
+    // Closes the pipe and waits for the crawler; returns its exit status
+    int wait();
+
+private:
+    pid_t pid = -1;
+    int readFd = -1;
+};
+
+struct IngestOptions {
+    std::size_t queueDepth = 64;    // documents parsed ahead of the agent
+    std::map<std::string, std::string> parameters{{"mode", "training"}};
+};
+
+struct IngestStats {
+    std::size_t documents = 0;
+    std::size_t bytes = 0;
+};
+
+// Pipelined ingestion: a reader thread parses records while the calling
+// thread hands each document to the agent as a TEXT context. No document
+// touches the filesystem on the way.
+class IngestionPipeline {
+public:
+    explicit IngestionPipeline(ModelAgent& agent, const IngestOptions& options = IngestOptions());
+
+    IngestStats run(int fd);
+
+private:
+    ModelAgent& agent;
+    IngestOptions options;
+};
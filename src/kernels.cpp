@@ -0,0 +1,254 @@
+#include "kernels.hpp"
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace kernels {
+    namespace {
+        const std::uint32_t PHILOX_M0 = 0xD2511F53;
+        const std::uint32_t PHILOX_M1 = 0xCD9E8D57;
+        const std::uint32_t PHILOX_W0 = 0x9E3779B9;
+        const std::uint32_t PHILOX_W1 = 0xBB67AE85;
+        const int PHILOX_ROUNDS = 10;
+
+        const std::size_t BLOCK_BYTES = 16;                 // one Philox4x32 output
+        const std::size_t MIN_BYTES_PER_THREAD = 4 << 20;
+        const std::size_t SCAN_STRIDE = 1 << 20;            // early-exit granularity
+
+        bool cpuHasAvx2() {
+#ifdef KERNELS_X86
+            static const bool supported = __builtin_cpu_supports("avx2");
+            return supported;
+#else
+            return false;
+#endif
+        }
+
+        // Runs fn(begin, end) over [0, count) split into contiguous ranges
+        template <typename Fn>
+        void parallelFor(std::size_t count, std::size_t unitBytes, unsigned int threads, Fn fn) {
+            if (threads == 0) threads = defaultThreadCount();
+            std::size_t maxUseful = std::max<std::size_t>(1, count * unitBytes / MIN_BYTES_PER_THREAD);
+            std::size_t workers = std::min<std::size_t>(threads, maxUseful);
+            if (workers <= 1) {
+                fn(0, count);
+                return;
+            }
+
+            std::vector<std::thread> pool;
+            std::size_t per = (count + workers - 1) / workers;
+            for (std::size_t w = 1; w < workers; ++w) {
+                std::size_t begin = std::min(count, w * per);
+                std::size_t end = std::min(count, begin + per);
+                pool.emplace_back(fn, begin, end);
+            }
+            fn(0, std::min(count, per));
+            for (auto& t : pool) t.join();
+        }
+
+        void philoxBlock(std::uint64_t counter, std::uint64_t stream, std::uint64_t seed,
+                         std::uint32_t out[4]) {
+            std::uint32_t c0 = static_cast<std::uint32_t>(counter);
+            std::uint32_t c1 = static_cast<std::uint32_t>(counter >> 32);
+            std::uint32_t c2 = static_cast<std::uint32_t>(stream);
+            std::uint32_t c3 = static_cast<std::uint32_t>(stream >> 32);
+            std::uint32_t k0 = static_cast<std::uint32_t>(seed);
+            std::uint32_t k1 = static_cast<std::uint32_t>(seed >> 32);
+
+            for (int round = 0; round < PHILOX_ROUNDS; ++round) {
+                std::uint64_t p0 = static_cast<std::uint64_t>(PHILOX_M0) * c0;
+                std::uint64_t p1 = static_cast<std::uint64_t>(PHILOX_M1) * c2;
+                std::uint32_t hi0 = static_cast<std::uint32_t>(p0 >> 32);
+                std::uint32_t lo0 = static_cast<std::uint32_t>(p0);
+                std::uint32_t hi1 = static_cast<std::uint32_t>(p1 >> 32);
+                std::uint32_t lo1 = static_cast<std::uint32_t>(p1);
+                c0 = hi1 ^ c1 ^ k0;
+                c1 = lo1;
+                c2 = hi0 ^ c3 ^ k1;
+                c3 = lo0;
+                k0 += PHILOX_W0;
+                k1 += PHILOX_W1;
+            }
+            out[0] = c0;
+            out[1] = c1;
+            out[2] = c2;
+            out[3] = c3;
+        }
+
+        // Scalar path for blocks [firstBlock, lastBlock); clips the final block to length
+        void fillBlocksScalar(std::uint8_t* out, std::size_t length, std::uint64_t firstBlock,
+                              std::uint64_t lastBlock, std::uint64_t seed, std::uint64_t stream,
+                              unsigned int scale) {
+            std::uint32_t words[4];
+            std::uint8_t bytes[BLOCK_BYTES];
+            for (std::uint64_t block = firstBlock; block < lastBlock; ++block) {
+                philoxBlock(block, stream, seed, words);
+                std::memcpy(bytes, words, BLOCK_BYTES);
+                std::size_t start = block * BLOCK_BYTES;
+                std::size_t n = std::min(BLOCK_BYTES, length - start);
+                for (std::size_t i = 0; i < n; ++i) {
+                    out[start + i] = static_cast<std::uint8_t>((bytes[i] * scale) >> 8);
+                }
+            }
+        }
+
+#ifdef KERNELS_X86
+        __attribute__((target("avx2")))
+        inline void mulhilo(__m256i a, __m256i m, __m256i& hi, __m256i& lo) {
+            // _mm256_mul_epu32 only multiplies the even 32-bit lanes, so the odd
+            // lanes go through a second multiply and are blended back in
+            __m256i even = _mm256_mul_epu32(a, m);
+            __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+            lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+            hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256i scaleBytes(__m256i v, __m256i scale) {
+            const __m256i zero = _mm256_setzero_si256();
+            __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(v, zero), scale), 8);
+            __m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(v, zero), scale), 8);
+            return _mm256_packus_epi16(lo, hi);
+        }
+
+        // Eight Philox streams per iteration, one per 32-bit lane. Only whole
+        // groups of eight blocks are produced; returns the number of blocks done.
+        __attribute__((target("avx2")))
+        std::uint64_t fillBlocksAvx2(std::uint8_t* out, std::uint64_t firstBlock, std::uint64_t blockCount,
+                                     std::uint64_t seed, std::uint64_t stream, unsigned int scale) {
+            const __m256i m0 = _mm256_set1_epi32(static_cast<int>(PHILOX_M0));
+            const __m256i m1 = _mm256_set1_epi32(static_cast<int>(PHILOX_M1));
+            const __m256i scaleVec = _mm256_set1_epi16(static_cast<short>(scale));
+            const __m256i streamLo = _mm256_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(stream)));
+            const __m256i streamHi = _mm256_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(stream >> 32)));
+
+            std::uint64_t groups = blockCount / 8;
+            alignas(32) std::uint32_t counterLo[8];
+            alignas(32) std::uint32_t counterHi[8];
+
+            for (std::uint64_t g = 0; g < groups; ++g) {
+                std::uint64_t base = firstBlock + g * 8;
+                for (int lane = 0; lane < 8; ++lane) {
+                    counterLo[lane] = static_cast<std::uint32_t>(base + lane);
+                    counterHi[lane] = static_cast<std::uint32_t>((base + lane) >> 32);
+                }
+                __m256i c0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(counterLo));
+                __m256i c1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(counterHi));
+                __m256i c2 = streamLo;
+                __m256i c3 = streamHi;
+                std::uint32_t k0 = static_cast<std::uint32_t>(seed);
+                std::uint32_t k1 = static_cast<std::uint32_t>(seed >> 32);
+
+                for (int round = 0; round < PHILOX_ROUNDS; ++round) {
+                    __m256i hi0, lo0, hi1, lo1;
+                    mulhilo(c0, m0, hi0, lo0);
+                    mulhilo(c2, m1, hi1, lo1);
+                    __m256i key0 = _mm256_set1_epi32(static_cast<int>(k0));
+                    __m256i key1 = _mm256_set1_epi32(static_cast<int>(k1));
+                    c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), key0);
+                    c1 = lo1;
+                    c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), key1);
+                    c3 = lo0;
+                    k0 += PHILOX_W0;
+                    k1 += PHILOX_W1;
+                }
+
+                // Transpose lanes back into block order: block j = (c0[j], c1[j], c2[j], c3[j])
+                __m256i t0 = _mm256_unpacklo_epi32(c0, c1);
+                __m256i t1 = _mm256_unpackhi_epi32(c0, c1);
+                __m256i t2 = _mm256_unpacklo_epi32(c2, c3);
+                __m256i t3 = _mm256_unpackhi_epi32(c2, c3);
+                __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+                __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+                __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+                __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+
+                __m256i* dst = reinterpret_cast<__m256i*>(out + base * BLOCK_BYTES);
+                _mm256_storeu_si256(dst + 0, scaleBytes(_mm256_permute2x128_si256(u0, u1, 0x20), scaleVec));
+                _mm256_storeu_si256(dst + 1, scaleBytes(_mm256_permute2x128_si256(u2, u3, 0x20), scaleVec));
+                _mm256_storeu_si256(dst + 2, scaleBytes(_mm256_permute2x128_si256(u0, u1, 0x31), scaleVec));
+                _mm256_storeu_si256(dst + 3, scaleBytes(_mm256_permute2x128_si256(u2, u3, 0x31), scaleVec));
+            }
+            return groups * 8;
+        }
+
+        __attribute__((target("avx2")))
+        bool allNonZeroAvx2(const std::uint8_t* data, std::size_t length) {
+            const __m256i zero = _mm256_setzero_si256();
+            std::size_t i = 0;
+            for (; i + 128 <= length; i += 128) {
+                const __m256i* p = reinterpret_cast<const __m256i*>(data + i);
+                __m256i acc = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256(p), zero),
+                                    _mm256_cmpeq_epi8(_mm256_loadu_si256(p + 1), zero)),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256(p + 2), zero),
+                                    _mm256_cmpeq_epi8(_mm256_loadu_si256(p + 3), zero)));
+                if (!_mm256_testz_si256(acc, acc)) return false;
+            }
+            for (; i + 32 <= length; i += 32) {
+                __m256i eq = _mm256_cmpeq_epi8(
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), zero);
+                if (!_mm256_testz_si256(eq, eq)) return false;
+            }
+            for (; i < length; ++i) {
+                if (data[i] == 0) return false;
+            }
+            return true;
+        }
+#endif
+
+        bool allNonZeroRange(const std::uint8_t* data, std::size_t length) {
+#ifdef KERNELS_X86
+            if (cpuHasAvx2()) return allNonZeroAvx2(data, length);
+#endif
+            return std::memchr(data, 0, length) == nullptr;
+        }
+    }
+
+    unsigned int defaultThreadCount() {
+        unsigned int n = std::thread::hardware_concurrency();
+        return n == 0 ? 1 : n;
+    }
+
+    void fillRandom(std::uint8_t* out, std::size_t length, std::uint64_t seed,
+                    std::uint64_t stream, std::uint8_t maxValue, unsigned int threads) {
+        if (length == 0) return;
+        const unsigned int scale = static_cast<unsigned int>(maxValue) + 1;
+        const std::uint64_t totalBlocks = (length + BLOCK_BYTES - 1) / BLOCK_BYTES;
+        const std::uint64_t fullBlocks = length / BLOCK_BYTES;
+
+        parallelFor(totalBlocks, BLOCK_BYTES, threads, [&](std::size_t begin, std::size_t end) {
+            std::uint64_t block = begin;
+#ifdef KERNELS_X86
+            if (cpuHasAvx2()) {
+                // Vector path stays within whole blocks; the ragged tail is scalar
+                std::uint64_t vectorEnd = std::min<std::uint64_t>(end, fullBlocks);
+                if (vectorEnd > block) {
+                    block += fillBlocksAvx2(out, block, vectorEnd - block, seed, stream, scale);
+                }
+            }
+#endif
+            fillBlocksScalar(out, length, block, end, seed, stream, scale);
+        });
+    }
+
+    bool allNonZero(const std::uint8_t* data, std::size_t length, unsigned int threads) {
+        std::atomic<bool> foundZero(false);
+        parallelFor(length, 1, threads, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t pos = begin; pos < end && !foundZero.load(std::memory_order_relaxed);
+                 pos += SCAN_STRIDE) {
+                if (!allNonZeroRange(data + pos, std::min(SCAN_STRIDE, end - pos))) {
+                    foundZero.store(true, std::memory_order_relaxed);
+                }
+            }
+        });
+        return !foundZero.load();
+    }
+}
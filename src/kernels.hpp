@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Bulk weight kernels. Both kernels split their input into chunks that run on
+// separate threads and use AVX2 where the CPU supports it, falling back to
+// portable scalar code otherwise.
+namespace kernels {
+    // Fills out[0, length) with bytes uniformly distributed over [0, maxValue].
+    // Bytes come from a counter-based Philox4x32-10 generator: byte i depends
+    // only on (seed, stream, i), so the result is identical for any thread
+    // count or instruction set.
+    void fillRandom(std::uint8_t* out, std::size_t length, std::uint64_t seed,
+                    std::uint64_t stream, std::uint8_t maxValue = 255,
+                    unsigned int threads = 0);
+
+    // True when none of the bytes in data[0, length) is zero
+    bool allNonZero(const std::uint8_t* data, std::size_t length, unsigned int threads = 0);
+
+    // Worker count used when a kernel is called with threads == 0
+    unsigned int defaultThreadCount();
+}
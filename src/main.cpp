@@ -4,9 +4,25 @@
 #include "model.hpp"
 #include "blockchain.hpp"
 #include "storage.hpp"
+#include "model_cache.hpp"
 #include "agent.hpp"
+#include "agent_runtime.hpp"
 #include "utils.hpp"
+#include "media_reader.hpp"
+#include "batch_trainer.hpp"
+#include "batch_scheduler.hpp"
+#include "ingest.hpp"
+#include "server.hpp"
+#include "weight_codec.hpp"
+#include "kernels.hpp"
+#include <csignal>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
 #include <memory>
 #include <stdexcept>
 #include <array>
@@ -15,7 +31,10 @@
 #include <iomanip>
 #include <chrono>
 #include <thread>
+#include <mutex>
 #include <map>
+#include <set>
+#include <algorithm>
 
 // Define the training configuration struct first
 struct TrainingConfig {
@@ -24,6 +43,13 @@ struct TrainingConfig {
     int iterations = 100;
     bool showProgress = false;
     std::string metricsFile;
+    size_t chunkSize = 0;   // streaming chunk size for AUDIO/VIDEO training
+    unsigned int readers = 2;           // batch training pipeline stages
+    unsigned int prepareWorkers = 0;
+    unsigned int trainThreads = 0;
+    size_t queueDepth = 64;
+    unsigned int passes = 1;            // --batch-train passes over the directory
+    unsigned int serverWorkers = 0;     // --serve request workers
 };
 
 void printProgress(int current, int total, double accuracy) {
@@ -57,45 +83,27 @@ void exportTrainingMetrics(const std::string& filePath,
 void processBatchTraining(const std::string& directory, MediaType mediaType, const TrainingConfig& config) {
     std::vector<MediaType> types = {mediaType};
     auto model = std::make_shared<AIModel>("BatchTrainModel", types);
-    ModelAgent agent(model);
-    int fileCount = 0;
-    int totalFiles = std::distance(std::filesystem::directory_iterator(directory),
-                                 std::filesystem::directory_iterator());
 
-    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
-        if (entry.is_regular_file()) {
-            try {
-                std::vector<uint8_t> data = utils::loadBinaryFile(entry.path().string());
-                std::string textContent(data.begin(), data.end());
-
-                std::map<std::string, std::string> params;
-                params["mode"] = "training";
-                params["learning_rate"] = std::to_string(config.learningRate);
-                params["batch_size"] = std::to_string(config.batchSize);
-                params["iterations"] = std::to_string(config.iterations);
-
-                AgentContext context{
-                    .mediaType = mediaType,
-                    .input = textContent,
-                    .binaryData = data,
-                    .parameters = params
-                };
-
-                agent.processContext(context);
-                fileCount++;
-
-                if (config.showProgress) {
-                    printProgress(fileCount, totalFiles, model->getAccuracy());
-                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                }
-            } catch (const std::exception& e) {
-                std::cerr << "Error processing file " << entry.path().filename() 
-                         << ": " << e.what() << std::endl;
-                continue;
-            }
-        }
+    BatchTrainingOptions options;
+    options.readers = config.readers;
+    options.prepareWorkers = config.prepareWorkers;
+    options.trainThreads = config.trainThreads;
+    options.queueDepth = config.queueDepth;
+    options.batchSize = static_cast<size_t>(std::max(1, config.batchSize));
+    options.passes = std::max(1u, config.passes);
+    options.parameters["mode"] = "training";
+    options.parameters["learning_rate"] = std::to_string(config.learningRate);
+    options.parameters["batch_size"] = std::to_string(config.batchSize);
+    options.parameters["iterations"] = std::to_string(config.iterations);
+    if (config.showProgress) {
+        options.onProgress = [&model](size_t done, size_t total) {
+            printProgress(static_cast<int>(done), static_cast<int>(total), model->getAccuracy());
+        };
     }
 
+    BatchTrainer trainer(model, mediaType, options);
+    BatchTrainingResult result = trainer.run(directory);
+
     if (config.showProgress) {
         std::cout << std::endl;
     }
@@ -106,7 +114,9 @@ void processBatchTraining(const std::string& directory, MediaType mediaType, con
     }
 
     std::cout << "\nTraining Summary:\n"
-              << "Files Processed: " << fileCount << "/" << totalFiles << "\n"
+              << "Files Processed: " << result.trained << "/" << result.files * options.passes
+              << " (" << result.files << " files x " << options.passes << " passes)\n"
+              << "Batches: " << result.batches << "\n"
               << "Final Accuracy: " << model->getAccuracy() << "\n"
               << "Model Version: " << model->getVersion() << std::endl;
 }
@@ -114,6 +124,23 @@ void processBatchTraining(const std::string& directory, MediaType mediaType, con
 void runTests();
 void testMediaModels();
 void testAgentCapabilities();
+void testSpanProcessing();
+void testBatchScheduler();
+void testFileIO();
+void testBatchTrainingOrder();
+void testCopyOnWrite();
+void testWeightLayout();
+void testRandomFill();
+void testDocumentStream();
+void testWeightEncodings();
+void testModelCatalog();
+void testCatalogQueries();
+void testModelCache();
+void testAgentRuntime();
+void testAgentCancellation();
+void testAgentState();
+void testDecisionHistory();
+void testAgentBatches();
 
 void printUsage() {
     std::cout << "Usage: aimarket [OPTION]... [FILE]\n"
@@ -124,28 +151,32 @@ void printUsage() {
               << "  --batch-train DIR --type TYPE Train with all files in directory\n"
               << "  --config FILE              Load training configuration\n"
               << "  --learning-rate RATE       Set learning rate (default: 0.01)\n"
-              << "  --batch-size SIZE          Set batch size (default: 32)\n"
+              << "  --batch-size SIZE          Set files per weight update (default: 32)\n"
               << "  --iterations NUM           Set training iterations (default: 100)\n"
+              << "  --passes NUM               Batch training passes over the directory (default: 1)\n"
               << "  --show-progress            Show training progress\n"
               << "  --export-metrics FILE      Export training metrics to file\n"
+              << "  --chunk-size BYTES         Chunk size for streaming AUDIO/VIDEO training\n"
+              << "  --readers NUM              Batch training file reader threads (default: 2)\n"
+              << "  --prepare-workers NUM      Batch training prepare threads (default: cores)\n"
+              << "  --train-threads NUM        Threads per weight update (default: cores)\n"
+              << "  --queue-depth NUM          Files in flight during batch training (default: 64)\n"
               << "  --reasoning                Get agent reasoning\n"
               << "  --test                     Run test suite\n"
               << "  --version                  Print version\n"
               << "  --help                     Print this help\n"
-              << "  --crawl URL                Crawl URL and train with content\n";
+              << "  --crawl URL [GOAL]         Crawl URL and train on pages as they arrive\n"
+              << "  --ingest FILE|-            Train on a document record stream\n"
+              << "  --serve SOCKET             Run as a daemon on a Unix domain socket\n"
+              << "  --workers NUM              Daemon request workers (default: cores)\n";
 }
 
-std::string exec(const char* cmd) {
-    std::array<char, 128> buffer;
-    std::string result;
-    std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd, "r"), pclose);
-    if (!pipe) {
-        throw std::runtime_error("popen() failed!");
-    }
-    while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
-        result += buffer.data();
+namespace {
+    MarketServer* activeServer = nullptr;
+
+    void stopServer(int) {
+        if (activeServer) activeServer->requestStop();
     }
-    return result;
 }
 
 int processCommandLine(int argc, char* argv[]) {
@@ -169,6 +200,20 @@ int processCommandLine(int argc, char* argv[]) {
             config.showProgress = true;
         } else if (arg == "--export-metrics" && i + 1 < argc) {
             config.metricsFile = argv[++i];
+        } else if (arg == "--chunk-size" && i + 1 < argc) {
+            config.chunkSize = std::stoull(argv[++i]);
+        } else if (arg == "--readers" && i + 1 < argc) {
+            config.readers = std::stoul(argv[++i]);
+        } else if (arg == "--prepare-workers" && i + 1 < argc) {
+            config.prepareWorkers = std::stoul(argv[++i]);
+        } else if (arg == "--train-threads" && i + 1 < argc) {
+            config.trainThreads = std::stoul(argv[++i]);
+        } else if (arg == "--passes" && i + 1 < argc) {
+            config.passes = std::stoul(argv[++i]);
+        } else if (arg == "--queue-depth" && i + 1 < argc) {
+            config.queueDepth = std::stoull(argv[++i]);
+        } else if (arg == "--workers" && i + 1 < argc) {
+            config.serverWorkers = std::stoul(argv[++i]);
         }
     }
 
@@ -205,33 +250,68 @@ int processCommandLine(int argc, char* argv[]) {
     if (command == "--crawl" && argc >= 3) {
         std::string url = argv[2];
         std::string goal = argc >= 4 ? argv[3] : "";
-        std::string mediaTypeStr = "TEXT";  
 
-        std::string cmd = "python3 src/web_crawler.py \"" + url + "\" \"" + goal + "\"";
-        std::string result = exec(cmd.c_str());
+        std::vector<MediaType> types = {MediaType::TEXT};
+        auto model = std::make_shared<AIModel>("WebCrawlerModel", types);
+        ModelAgent agent(model, nullptr, AgentStateOptions::forModel(*model));
+
+        // Pages are trained on as the crawler streams them out
+        CrawlerProcess crawler(url, goal);
+        IngestionPipeline pipeline(agent);
+        IngestStats stats = pipeline.run(crawler.output());
+        int status = crawler.wait();
+        if (status != 0) {
+            std::cerr << "Error crawling website: crawler exited with status " << status << std::endl;
+            return 1;
+        }
 
-        if (result.find("\"success\": true") != std::string::npos) {
-            std::vector<MediaType> types = {MediaType::TEXT};
-            auto model = std::make_shared<AIModel>("WebCrawlerModel", types);
-            ModelAgent agent(model);
+        std::cout << "Training complete. Accuracy: " << model->getAccuracy()
+                  << "\nIngested " << stats.documents << " documents (" << stats.bytes << " bytes)"
+                  << "\nFeedback: " << agent.getActionReasoning() << std::endl;
+        return 0;
+    }
 
-            std::vector<uint8_t> data = utils::loadBinaryFile("temp/crawled_data.txt");
-            std::string textContent(data.begin(), data.end());
+    if (command == "--serve" && argc >= 3) {
+        ServerConfig serverConfig;
+        serverConfig.socketPath = argv[2];
+        serverConfig.workers = config.serverWorkers;
+        MarketServer server(serverConfig);
+
+        activeServer = &server;
+        std::signal(SIGINT, stopServer);
+        std::signal(SIGTERM, stopServer);
+        server.run();
+        activeServer = nullptr;
+        return 0;
+    }
 
-            AgentContext context{
-                .mediaType = MediaType::TEXT,
-                .input = textContent,
-                .binaryData = data,
-                .parameters = {{"mode", "training"}}
-            };
+    if (command == "--ingest" && argc >= 3) {
+        std::string source = argv[2];
+        int fd = STDIN_FILENO;
+        if (source != "-") {
+            fd = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                std::cerr << "Error: Cannot open " << source << ": " << std::strerror(errno) << std::endl;
+                return 1;
+            }
+        }
 
-            agent.processContext(context);
-            std::cout << "Training complete. Accuracy: " << model->getAccuracy()
-                      << "\nFeedback: " << agent.getActionReasoning() << std::endl;
-        } else {
-            std::cerr << "Error crawling website: " << result << std::endl;
-            return 1;
+        std::vector<MediaType> types = {MediaType::TEXT};
+        auto model = std::make_shared<AIModel>("IngestModel", types);
+        ModelAgent agent(model, nullptr, AgentStateOptions::forModel(*model));
+        IngestionPipeline pipeline(agent);
+        IngestStats stats;
+        try {
+            stats = pipeline.run(fd);
+        } catch (...) {
+            if (fd != STDIN_FILENO) ::close(fd);
+            throw;
         }
+        if (fd != STDIN_FILENO) ::close(fd);
+
+        std::cout << "Training complete. Accuracy: " << model->getAccuracy()
+                  << "\nIngested " << stats.documents << " documents (" << stats.bytes << " bytes)"
+                  << std::endl;
         return 0;
     }
 
@@ -255,15 +335,12 @@ int processCommandLine(int argc, char* argv[]) {
 
         std::vector<MediaType> types = {mediaType};
         auto model = std::make_shared<AIModel>("ProcessModel", types);
-        ModelAgent agent(model);
-
-        std::vector<uint8_t> data = utils::loadBinaryFile(filePath);
-        std::string textContent(data.begin(), data.end());
+        ModelAgent agent(model, nullptr, AgentStateOptions::forModel(*model));
 
+        // The loaded (or mapped) file is the context's only copy of the input
         AgentContext context{
             .mediaType = mediaType,
-            .input = textContent,
-            .binaryData = data,
+            .payload = AgentPayload(utils::loadFile(filePath)),
             .parameters = {{"mode", "process"}}
         };
 
@@ -292,17 +369,20 @@ int processCommandLine(int argc, char* argv[]) {
 
         std::vector<MediaType> types = {mediaType};
         auto model = std::make_shared<AIModel>("TrainModel", types);
-        ModelAgent agent(model);
 
-        std::vector<uint8_t> data = utils::loadBinaryFile(filePath);
-        std::string textContent(data.begin(), data.end());
+        ModelAgent agent(model, nullptr, AgentStateOptions::forModel(*model));
 
-        AgentContext context{
-            .mediaType = mediaType,
-            .input = textContent,
-            .binaryData = data,
-            .parameters = {{"mode", "training"}}
-        };
+        AgentContext context{.mediaType = mediaType, .payload = {}, .parameters = {{"mode", "training"}}};
+        if (mediaType == MediaType::AUDIO || mediaType == MediaType::VIDEO) {
+            // Large media is streamed from disk instead of being loaded whole
+            context.payload = AgentPayload(std::make_shared<FileMediaReader>(filePath));
+            if (config.chunkSize != 0) {
+                context.parameters["chunk_size"] = std::to_string(config.chunkSize);
+            }
+        } else {
+            // The loaded (or mapped) file is the context's only copy of the input
+            context.payload = AgentPayload(utils::loadFile(filePath));
+        }
 
         agent.processContext(context);
         std::cout << "Training complete. Accuracy: " << model->getAccuracy()
@@ -342,6 +422,22 @@ void printSeparator() {
     std::cout << "\n" << std::string(50, '-') << "\n";
 }
 
+// Fails the --test run, naming the expectation that did not hold
+void expect(bool condition, const std::string& what) {
+    if (!condition) {
+        throw std::runtime_error("Test failed: " + what);
+    }
+}
+
+// The default video layout (224x224x3 at 30 fps, 1000 outputs) needs 4.5 GB
+// of weights. Test models that train every media type use a one-frame
+// layout so --test fits in ordinary memory.
+void useTestVideoLayout(AIModel& model) {
+    MediaProperties props = model.getMediaProperties(MediaType::VIDEO);
+    props.visual.frameRate = 1;
+    model.configureMediaProperties(MediaType::VIDEO, props);
+}
+
 void testMediaModels() {
     std::cout << "\nTesting Multi-Modal Model Capabilities...\n";
     printSeparator();
@@ -353,6 +449,7 @@ void testMediaModels() {
         MediaType::VIDEO
     };
     AIModel multiModel("MultiModal-Mock", allTypes);
+    useTestVideoLayout(multiModel);
 
     std::cout << "Testing Text Processing:\n";
     multiModel.trainWithText("Sample training text for natural language processing.");
@@ -412,8 +509,7 @@ void testAgentCapabilities() {
     std::cout << "Test 1: Agent Text Processing\n";
     AgentContext textContext{
         .mediaType = MediaType::TEXT,
-        .input = "Sample text for agent processing",
-        .binaryData = std::vector<uint8_t>(),
+        .payload = AgentPayload(std::string("Sample text for agent processing")),
         .parameters = {{"mode", "analysis"}}
     };
     agent.processContext(textContext);
@@ -423,8 +519,7 @@ void testAgentCapabilities() {
     std::vector<uint8_t> mockImageData(224 * 224 * 3, 128);
     AgentContext imageContext{
         .mediaType = MediaType::IMAGE,
-        .input = "",
-        .binaryData = mockImageData,
+        .payload = AgentPayload(std::move(mockImageData)),
         .parameters = {{"mode", "training"}}
     };
     agent.processContext(imageContext);
@@ -445,6 +540,1197 @@ void testAgentCapabilities() {
               << "Reasoning: " << agent.getActionReasoning() << "\n";
 }
 
+void testWeightLayout() {
+    std::cout << "\nTesting Weight Section Sizes...\n";
+    printSeparator();
+
+    const std::pair<MediaType, size_t> defaults[] = {
+        {MediaType::TEXT, 25600000},            // 50000 tokens x 512 outputs
+        {MediaType::IMAGE, 150528000},          // 224x224x3 x 1000 outputs
+        {MediaType::AUDIO, 8192000},            // 16 kHz mono x 512 outputs
+        {MediaType::VIDEO, 4515840000},         // 224x224x3 at 30 fps x 1000 outputs
+    };
+    for (const auto& [type, expected] : defaults) {
+        AIModel model("Layout-Mock", {type});
+        std::string name = "section of media type " + std::to_string(static_cast<int>(type));
+        expect(model.sectionWeightBytes(type) == expected, name + " has its default size");
+
+        size_t trained = expected;
+        if (type == MediaType::VIDEO) {
+            useTestVideoLayout(model);
+            trained = 150528000;
+            expect(model.sectionWeightBytes(type) == trained, name + " follows its configuration");
+        }
+        model.train();
+        expect(model.weightBytes() == trained, name + " allocates its layout size");
+        std::cout << "Media type " << static_cast<int>(type) << ": " << expected
+                  << " bytes by default, " << model.weightBytes() << " bytes trained\n";
+    }
+}
+
+// Read end of a pipe that yields bytes and then EOF; bytes must fit the
+// pipe buffer
+int streamFixture(const std::string& bytes) {
+    int fds[2];
+    if (::pipe2(fds, O_CLOEXEC) != 0) {
+        throw std::runtime_error(std::string("Failed to create pipe: ") + std::strerror(errno));
+    }
+    ssize_t written = ::write(fds[1], bytes.data(), bytes.size());
+    ::close(fds[1]);
+    if (written != static_cast<ssize_t>(bytes.size())) {
+        ::close(fds[0]);
+        throw std::runtime_error("Failed to fill document stream fixture");
+    }
+    return fds[0];
+}
+
+// Reads records from fd until the stream ends or fails; returns the number
+// read and stores the failure, if any, in error
+size_t readDocuments(int fd, std::string& error) {
+    DocumentStreamReader reader(fd);
+    IngestDocument document;
+    size_t count = 0;
+    try {
+        while (reader.next(document)) {
+            count++;
+        }
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    ::close(fd);
+    return count;
+}
+
+void testDocumentStream() {
+    std::cout << "\nTesting Document Stream Ingestion...\n";
+    printSeparator();
+
+    std::vector<IngestDocument> fixture = {
+        {"https://example.com/a", "First crawled page about model training"},
+        {"https://example.com/b", "Second page"},
+        {"local", std::string(4096, 'x')},
+    };
+    std::string records;
+    size_t textBytes = 0;
+    for (const auto& document : fixture) {
+        encodeDocument(document, records);
+        textBytes += document.text.size();
+    }
+
+    auto model = std::make_shared<AIModel>("Ingest-Mock", std::vector<MediaType>{MediaType::TEXT});
+    ModelAgent agent(model);
+    IngestOptions options;
+    options.parameters = {{"mode", "analysis"}};
+    IngestionPipeline pipeline(agent, options);
+    int fd = streamFixture(records);
+    IngestStats stats = pipeline.run(fd);
+    ::close(fd);
+    expect(stats.documents == fixture.size(), "pipeline ingests every record");
+    expect(stats.bytes == textBytes, "pipeline counts the text bytes of every record");
+    std::cout << "Ingested " << stats.documents << " documents (" << stats.bytes << " bytes)\n";
+
+    // A record cut short after its header: the complete record still counts
+    std::string truncated;
+    encodeDocument(fixture[0], truncated);
+    std::string cut;
+    encodeDocument(fixture[1], cut);
+    truncated += cut.substr(0, cut.size() - 4);
+    std::string error;
+    size_t read = readDocuments(streamFixture(truncated), error);
+    expect(read == 1 && error.find("Truncated") != std::string::npos,
+           "a truncated record fails after the complete ones");
+    std::cout << "Truncated stream: " << read << " document, then \"" << error << "\"\n";
+
+    // A header announcing more text than the reader accepts
+    std::string oversized;
+    encodeDocument(fixture[0], oversized);
+    IngestDocument huge{"huge", ""};
+    size_t header = oversized.size();
+    encodeDocument(huge, oversized);
+    uint32_t tooLong = DocumentStreamReader::MAX_TEXT_LENGTH + 1;
+    std::memcpy(oversized.data() + header + 4, &tooLong, sizeof(tooLong));
+    error.clear();
+    read = readDocuments(streamFixture(oversized), error);
+    expect(read == 1 && error.find("size limits") != std::string::npos,
+           "an oversized record length is rejected before any allocation");
+    std::cout << "Oversized record: " << read << " document, then \"" << error << "\"\n";
+}
+
+// Fresh temporary working directory for tests that save models or catalogs
+// under relative paths; the previous directory is restored on destruction
+struct ScratchDirectory {
+    std::filesystem::path previous;
+    std::filesystem::path path;
+
+    explicit ScratchDirectory(const std::string& name)
+        : previous(std::filesystem::current_path()),
+          path(std::filesystem::temp_directory_path() /
+               ("aimarket-" + name + "-" + std::to_string(::getpid()))) {
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path / "models");
+        std::filesystem::current_path(path);
+    }
+
+    ~ScratchDirectory() {
+        std::error_code ignored;
+        std::filesystem::current_path(previous, ignored);
+        std::filesystem::remove_all(path, ignored);
+    }
+};
+
+bool sameWeights(const AIModel& a, const AIModel& b, MediaType type) {
+    const WeightBuffer& left = a.getSectionWeights(type);
+    const WeightBuffer& right = b.getSectionWeights(type);
+    return left.size() == right.size() && std::equal(left.data(), left.data() + left.size(), right.data());
+}
+
+void testRandomFill() {
+    std::cout << "\nTesting Deterministic Weight Generation...\n";
+    printSeparator();
+
+    // Philox4x32-10 known answer for counter 0 and key 0 (Random123's
+    // kat_vectors); with maxValue 255 the bytes are the raw output words
+    const uint32_t known[4] = {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8};
+    uint8_t block[16];
+    kernels::fillRandom(block, sizeof(block), 0, 0, 255, 1);
+    expect(std::memcmp(block, known, sizeof(block)) == 0, "Philox matches its known-answer vector");
+
+    // Whole groups of eight blocks take the AVX2 path where the CPU has it,
+    // while fewer than eight blocks are always scalar
+    for (uint8_t maxValue : {uint8_t(255), uint8_t(25)}) {
+        std::vector<uint8_t> wide(8 * 16 * 4);
+        std::vector<uint8_t> scalar(7 * 16 + 5);
+        kernels::fillRandom(wide.data(), wide.size(), 42, 7, maxValue, 1);
+        kernels::fillRandom(scalar.data(), scalar.size(), 42, 7, maxValue, 1);
+        expect(std::equal(scalar.begin(), scalar.end(), wide.begin()),
+               "the vector and scalar paths produce the same bytes");
+        expect(*std::max_element(wide.begin(), wide.end()) <= maxValue, "bytes stay within maxValue");
+    }
+
+    // Large enough to be split across threads, with ranges that do not
+    // start on a group of eight blocks and a ragged final block
+    std::vector<uint8_t> single(24 * 1024 * 1024 + 13);
+    std::vector<uint8_t> threaded(single.size());
+    kernels::fillRandom(single.data(), single.size(), 0x1234, 99, 25, 1);
+    kernels::fillRandom(threaded.data(), threaded.size(), 0x1234, 99, 25, 5);
+    expect(single == threaded, "a fill gives the same bytes on one thread or several");
+
+    // Training generates the same weights whatever the thread count
+    AIModel model("Determinism-Mock", {MediaType::TEXT});
+    auto serial = model.clone();
+    auto parallel = model.clone();
+    serial->setComputeThreads(1);
+    parallel->setComputeThreads(4);
+    serial->train();
+    parallel->train();
+    expect(sameWeights(*serial, *parallel, MediaType::TEXT), "training is independent of the thread count");
+    std::cout << "Compared " << single.size() << " generated bytes and "
+              << serial->weightBytes() << " trained bytes\n";
+}
+
+void testWeightEncodings() {
+    std::cout << "\nTesting Weight Encodings...\n";
+    printSeparator();
+
+    // Mostly small values with occasional large ones; the odd length leaves
+    // a partial block and a lone trailing code for the 4-bit formats
+    std::vector<uint8_t> weights(4099);
+    uint32_t state = 12345;
+    for (auto& weight : weights) {
+        state = state * 1103515245u + 12345u;
+        weight = static_cast<uint8_t>((state >> 16) & ((state >> 30) == 0 ? 0xFF : 0x0F));
+    }
+
+    for (WeightEncoding encoding : {WeightEncoding::RAW, WeightEncoding::PACK4,
+                                    WeightEncoding::BLOCK4, WeightEncoding::RANS}) {
+        const WeightCodec& codec = codecFor(encoding);
+        std::vector<uint8_t> encoded = codec.encode(weights.data(), weights.size());
+        std::vector<uint8_t> decoded(weights.size());
+        codec.decode(encoded.data(), encoded.size(), decoded.data(), decoded.size());
+
+        int maxError = 0;
+        for (size_t i = 0; i < weights.size(); ++i) {
+            maxError = std::max(maxError, std::abs(int(decoded[i]) - int(weights[i])));
+        }
+        // PACK4 drops at most 4 low bits; BLOCK4 rounds to half its largest step (17)
+        int allowed = codec.isLossless() ? 0 : encoding == WeightEncoding::PACK4 ? 15 : 8;
+        expect(maxError <= allowed, codec.name() + " round-trips within its error bound");
+        if (encoding != WeightEncoding::RAW) {
+            expect(encoded.size() < weights.size(), codec.name() + " shrinks the section");
+
+            bool rejected = false;
+            try {
+                codec.decode(encoded.data(), encoded.size() / 2, decoded.data(), decoded.size());
+            } catch (const std::runtime_error&) {
+                rejected = true;
+            }
+            expect(rejected, codec.name() + " rejects a truncated section");
+        }
+        std::cout << codec.name() << ": " << weights.size() << " -> " << encoded.size()
+                  << " bytes, max error " << maxError << "\n";
+    }
+
+    std::vector<uint8_t> small(weights.size());
+    std::transform(weights.begin(), weights.end(), small.begin(), [](uint8_t w) { return w & 0x0F; });
+    const WeightCodec& pack4 = codecFor(WeightEncoding::PACK4);
+    std::vector<uint8_t> packed = pack4.encode(small.data(), small.size());
+    std::vector<uint8_t> unpacked(small.size());
+    pack4.decode(packed.data(), packed.size(), unpacked.data(), unpacked.size());
+    expect(unpacked == small, "PACK4 is exact for values up to 15");
+
+    // Save with mixed encodings, then load back with checksum verification
+    ScratchDirectory scratch("encodings");
+    AIModel model("Encoding-Mock", {MediaType::TEXT, MediaType::AUDIO});
+    model.setWeightEncoding(MediaType::AUDIO, WeightEncoding::RANS);
+    model.train();
+    model.save();
+
+    WeightLoadOptions verified;
+    verified.verifyChecksums = true;
+    AIModel loaded("Loaded-Mock", {MediaType::TEXT});
+    loaded.load(model.getId(), model.getVersion(), verified);
+    expect(loaded.getWeightEncoding(MediaType::AUDIO) == WeightEncoding::RANS,
+           "loaded model keeps the section encoding");
+    expect(sameWeights(model, loaded, MediaType::TEXT) && sameWeights(model, loaded, MediaType::AUDIO),
+           "saved weights load back unchanged");
+
+    // Flip the last byte of the file, which belongs to the last section
+    std::string path = "models/" + model.getId() + "_v" + std::to_string(model.getVersion()) + ".model";
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(-1, std::ios::end);
+        char last = 0;
+        file.get(last);
+        file.seekp(-1, std::ios::end);
+        file.put(static_cast<char>(last ^ 0x5A));
+    }
+    bool corrupted = false;
+    try {
+        AIModel damaged("Damaged-Mock", {MediaType::TEXT});
+        damaged.load(model.getId(), model.getVersion(), verified);
+        damaged.getSectionWeights(MediaType::TEXT);
+        damaged.getSectionWeights(MediaType::AUDIO);
+    } catch (const std::runtime_error& e) {
+        corrupted = std::string(e.what()).find("checksum") != std::string::npos;
+    }
+    expect(corrupted, "checksum verification rejects a corrupted section");
+    std::cout << "Saved and reloaded " << model.weightBytes() << " bytes of weights with verified checksums\n";
+}
+
+// One output per section, so tests can train many models cheaply
+void useTinyLayout(AIModel& model) {
+    for (MediaType type : model.getSupportedTypes()) {
+        MediaProperties props = model.getMediaProperties(type);
+        props.outputSize = 1;
+        if (type == MediaType::VIDEO) props.visual.frameRate = 1;
+        model.configureMediaProperties(type, props);
+    }
+}
+
+std::shared_ptr<AIModel> makeTinyModel(const std::string& name, const std::vector<MediaType>& types,
+                                       int trainingSteps) {
+    auto model = std::make_shared<AIModel>(name, types);
+    useTinyLayout(*model);
+    for (int i = 0; i < trainingSteps; ++i) {
+        model->train();
+    }
+    return model;
+}
+
+void testSpanProcessing() {
+    std::cout << "\nTesting Span Processing Into Pooled Buffers...\n";
+    printSeparator();
+
+    auto model = makeTinyModel("Span-Mock", {MediaType::TEXT, MediaType::IMAGE}, 1);
+    BufferPool pool;
+
+    // Text results match the allocating form, written into a leased buffer
+    const std::string text = "span processing sample";
+    std::span<const uint8_t> textBytes(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+    const uint8_t* firstBuffer = nullptr;
+    {
+        auto output = pool.acquire(model->processedSize(MediaType::TEXT, text.size()));
+        firstBuffer = output.data();
+        size_t written = model->processInto(MediaType::TEXT, textBytes, output.span());
+        expect(std::string(reinterpret_cast<const char*>(output.data()), written) == model->processText(text),
+               "processInto writes the same text as processText");
+    }
+    {
+        auto again = pool.acquire(model->processedSize(MediaType::TEXT, text.size()));
+        expect(again.data() == firstBuffer && pool.getStats().hits == 1, "a released buffer is leased again");
+    }
+    const std::string longText(5000, 'x');
+    expect(model->processedSize(MediaType::TEXT, longText.size()) == model->processText(longText).size(),
+           "processedSize covers text cut to the maximum sequence length");
+
+    // Media is copied through, or left alone when processed in place
+    std::vector<uint8_t> image(3000);
+    for (size_t i = 0; i < image.size(); ++i) image[i] = static_cast<uint8_t>(i * 7);
+    {
+        auto output = pool.acquire(model->processedSize(MediaType::IMAGE, image.size()));
+        size_t written = model->processInto(MediaType::IMAGE, image, output.span());
+        expect(written == image.size() && std::equal(image.begin(), image.end(), output.data()),
+               "processInto copies media into the leased buffer");
+    }
+    std::vector<uint8_t> inPlace = image;
+    expect(model->processImageInto(inPlace, inPlace) == image.size() && inPlace == image,
+           "media may be processed in place");
+
+    bool tooSmall = false;
+    try {
+        std::vector<uint8_t> small(image.size() - 1);
+        model->processInto(MediaType::IMAGE, image, small);
+    } catch (const std::runtime_error&) {
+        tooSmall = true;
+    }
+    expect(tooSmall, "an output span that is too small is rejected");
+
+    // Agents sharing the pool lease their PROCESS outputs from it
+    auto shared = std::make_shared<BufferPool>();
+    ModelAgent agent(model, shared);
+    AgentContext context{.mediaType = MediaType::IMAGE, .payload = AgentPayload(image), .parameters = {}};
+    for (int i = 0; i < 3; ++i) {
+        expect(agent.performAction(*model, AgentAction::PROCESS, context), "PROCESS succeeds");
+    }
+    BufferPool::Stats stats = shared->getStats();
+    expect(stats.misses == 1 && stats.hits == 2 && stats.pooled == 1, "repeated PROCESS reuses one buffer");
+    std::cout << "Pool hits: " << stats.hits << ", misses: " << stats.misses << "\n";
+}
+
+std::vector<uint8_t> bytesOf(const std::string& text) {
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+void testBatchScheduler() {
+    std::cout << "\nTesting Dynamic Batching...\n";
+    printSeparator();
+
+    std::shared_ptr<const AIModel> model = makeTinyModel("Scheduler-Mock", {MediaType::TEXT}, 1);
+    using namespace std::chrono_literals;
+
+    // Full batches go out without waiting for the deadline
+    {
+        BatchScheduler scheduler(model, MediaType::TEXT, BatchConfig{4, 10s});
+        std::vector<std::future<std::vector<uint8_t>>> results;
+        for (int i = 0; i < 8; ++i) {
+            results.push_back(scheduler.submit(bytesOf("request " + std::to_string(i))));
+        }
+        for (int i = 0; i < 8; ++i) {
+            expect(results[i].wait_for(5s) == std::future_status::ready, "a full batch is dispatched at once");
+            expect(results[i].get() == bytesOf("Processed: request " + std::to_string(i)),
+                   "each request gets its own result");
+        }
+        BatchScheduler::Stats stats = scheduler.getStats();
+        expect(stats.requests == 8 && stats.batches == 2 && stats.largestBatch == 4,
+               "requests are dispatched in batches of maxBatchSize");
+    }
+
+    // A batch that does not fill is flushed at the oldest request's deadline
+    {
+        BatchScheduler scheduler(model, MediaType::TEXT, BatchConfig{32, 200ms});
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::future<std::vector<uint8_t>>> results;
+        for (int i = 0; i < 3; ++i) {
+            results.push_back(scheduler.submit(bytesOf("late " + std::to_string(i))));
+        }
+        for (auto& result : results) {
+            expect(result.wait_for(5s) == std::future_status::ready, "a partial batch is flushed");
+        }
+        auto waited = std::chrono::steady_clock::now() - start;
+        BatchScheduler::Stats stats = scheduler.getStats();
+        expect(waited >= 200ms && stats.batches == 1 && stats.largestBatch == 3,
+               "a partial batch waits for its deadline and goes out whole");
+    }
+
+    // Shutting down dispatches what is queued and refuses new requests
+    {
+        BatchScheduler scheduler(model, MediaType::TEXT, BatchConfig{32, 10s});
+        auto queued = scheduler.submit(bytesOf("queued"));
+        scheduler.shutdown();
+        expect(queued.wait_for(0s) == std::future_status::ready && queued.get() == bytesOf("Processed: queued"),
+               "shutdown dispatches queued requests");
+        bool refused = false;
+        try {
+            scheduler.submit(bytesOf("too late"));
+        } catch (const std::runtime_error&) {
+            refused = true;
+        }
+        expect(refused, "a shut down scheduler refuses requests");
+    }
+    std::cout << "Batched, flushed and drained requests as configured\n";
+}
+
+// Names in the current directory other than the given ones
+size_t strayFiles(std::initializer_list<std::string> expected) {
+    size_t stray = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(".")) {
+        std::string name = entry.path().filename().string();
+        if (std::find(expected.begin(), expected.end(), name) == expected.end()) {
+            stray++;
+        }
+    }
+    return stray;
+}
+
+void testFileIO() {
+    std::cout << "\nTesting File Loading and Atomic Saves...\n";
+    printSeparator();
+
+    ScratchDirectory scratch("file-io");
+    std::vector<uint8_t> large(3 * 1024 * 1024 + 17);
+    for (size_t i = 0; i < large.size(); ++i) large[i] = static_cast<uint8_t>(i ^ (i >> 9));
+    const std::vector<uint8_t> small = bytesOf("small file contents");
+    utils::saveBinaryFile("large.bin", large);
+    utils::saveBinaryFile("small.bin", small, true);
+
+    // Every mode yields the same bytes; AUTO maps large files only
+    for (auto mode : {utils::LoadMode::AUTO, utils::LoadMode::READ, utils::LoadMode::MAP}) {
+        utils::FileBuffer file = utils::loadFile("large.bin", mode);
+        expect(file.size() == large.size() && std::equal(large.begin(), large.end(), file.data()),
+               "loadFile returns the file's bytes in every mode");
+    }
+    expect(utils::loadFile("large.bin").isMapped() && !utils::loadFile("small.bin").isMapped(),
+           "AUTO maps large files and reads small ones");
+    expect(utils::loadBinaryFile("small.bin") == small, "loadBinaryFile reads the whole file");
+    expect(!utils::loadFile("/proc/self/cmdline").span().empty(), "files without a size are read to EOF");
+
+    bool named = false;
+    try {
+        utils::loadFile("missing.bin");
+    } catch (const std::runtime_error& e) {
+        named = std::string(e.what()).find("missing.bin") != std::string::npos;
+    }
+    expect(named, "a failed load names the file");
+
+    // A write that fails part-way leaves the previous file and no temporary.
+    // The file size limit makes write fail with EFBIG instead of raising SIGXFSZ.
+    rlimit previousLimit;
+    ::getrlimit(RLIMIT_FSIZE, &previousLimit);
+    auto previousHandler = std::signal(SIGXFSZ, SIG_IGN);
+    rlimit limit = previousLimit;
+    limit.rlim_cur = 64 * 1024;
+    ::setrlimit(RLIMIT_FSIZE, &limit);
+    bool failed = false;
+    try {
+        utils::saveBinaryFile("small.bin", large, true);
+    } catch (const std::runtime_error&) {
+        failed = true;
+    }
+    ::setrlimit(RLIMIT_FSIZE, &previousLimit);
+    std::signal(SIGXFSZ, previousHandler);
+    expect(failed, "a save past the file size limit fails");
+    expect(utils::loadBinaryFile("small.bin") == small, "a failed atomic save keeps the previous file");
+
+    // So does one whose final rename fails
+    std::filesystem::create_directories("target/occupied");
+    bool renameFailed = false;
+    try {
+        utils::saveBinaryFile("target", small, true);
+    } catch (const std::runtime_error&) {
+        renameFailed = true;
+    }
+    expect(renameFailed && std::filesystem::is_directory("target/occupied"),
+           "a failed rename leaves the destination alone");
+    expect(strayFiles({"models", "large.bin", "small.bin", "target"}) == 0,
+           "failed atomic saves remove their temporary files");
+    std::cout << "Loaded " << large.size() << " bytes three ways; failed saves left no trace\n";
+}
+
+void testBatchTrainingOrder() {
+    std::cout << "\nTesting Batch Training Order...\n";
+    printSeparator();
+
+    // Written in reverse so creation order is not the sorted order; the
+    // empty file is rejected by the agent
+    ScratchDirectory scratch("batch-order");
+    std::filesystem::create_directories("samples");
+    const size_t fileCount = 18;
+    std::vector<std::string> contents(fileCount);
+    for (size_t i = fileCount; i-- > 0;) {
+        contents[i] = i == 5 ? "" : "sample " + std::to_string(i) + std::string(i * 13, 'a' + i % 26);
+        char name[32];
+        std::snprintf(name, sizeof(name), "samples/%03zu.txt", i);
+        utils::saveBinaryFile(name, bytesOf(contents[i]));
+    }
+
+    auto base = makeTinyModel("Order-Mock", {MediaType::TEXT}, 1);
+    const size_t batchSize = 4;
+    const unsigned int passes = 2;
+
+    // The same minibatches applied directly, in sorted order
+    auto reference = base->clone();
+    for (unsigned int pass = 0; pass < passes; ++pass) {
+        for (size_t first = 0; first < fileCount; first += batchSize) {
+            std::vector<std::span<const uint8_t>> samples;
+            for (size_t i = first; i < std::min(fileCount, first + batchSize); ++i) {
+                if (!contents[i].empty()) {
+                    samples.emplace_back(reinterpret_cast<const uint8_t*>(contents[i].data()), contents[i].size());
+                }
+            }
+            reference->trainBatch(MediaType::TEXT, samples);
+        }
+    }
+
+    const std::pair<unsigned int, unsigned int> stages[] = {{1, 1}, {4, 3}, {3, 8}};
+    for (auto [readers, preparers] : stages) {
+        auto model = base->clone();
+        BatchTrainingOptions options;
+        options.readers = readers;
+        options.prepareWorkers = preparers;
+        options.trainThreads = 1;
+        options.queueDepth = 3;
+        options.batchSize = batchSize;
+        options.passes = passes;
+        size_t lastProgress = 0;
+        bool ordered = true;
+        options.onProgress = [&](size_t done, size_t) {
+            ordered = ordered && done > lastProgress;
+            lastProgress = done;
+        };
+        BatchTrainer trainer(model, MediaType::TEXT, options);
+        BatchTrainingResult result = trainer.run("samples");
+
+        std::string name = std::to_string(readers) + " readers and " + std::to_string(preparers) + " preparers";
+        expect(result.files == fileCount && result.trained == (fileCount - 1) * passes &&
+               result.failed == passes && result.batches == passes * ((fileCount + batchSize - 1) / batchSize),
+               "training with " + name + " counts every file");
+        expect(ordered && lastProgress == fileCount * passes, "progress advances file by file with " + name);
+        expect(sameWeights(*reference, *model, MediaType::TEXT),
+               "training with " + name + " applies files in sorted order");
+    }
+    std::cout << "Matched the sorted-order reference for " << std::size(stages) << " stage layouts\n";
+}
+
+std::vector<uint8_t> sectionBytes(const AIModel& model, MediaType type) {
+    const WeightBuffer& weights = model.getSectionWeights(type);
+    return std::vector<uint8_t>(weights.data(), weights.data() + weights.size());
+}
+
+void testCopyOnWrite() {
+    std::cout << "\nTesting Copy-on-Write Model Copies...\n";
+    printSeparator();
+
+    auto base = makeTinyModel("Cow-Mock", {MediaType::TEXT, MediaType::AUDIO}, 2);
+    const unsigned int baseVersion = base->getVersion();
+    // Snapshots are keyed by the version a training step started from
+    const unsigned int baseStep = baseVersion - 1;
+    const std::vector<uint8_t> baseText = sectionBytes(*base, MediaType::TEXT);
+    const std::vector<uint8_t> baseSnapshot = base->getWeightSnapshot(baseStep, MediaType::TEXT);
+    expect(baseSnapshot == baseText, "the latest snapshot regenerates the current weights");
+
+    // A clone shares the weight bytes until it trains
+    auto copy = base->clone();
+    expect(copy->getSectionWeights(MediaType::TEXT).data() == base->getSectionWeights(MediaType::TEXT).data(),
+           "a clone shares its weights");
+
+    copy->trainWithText("clone-only sample");
+    copy->trainWithText("another clone-only sample");
+    expect(sectionBytes(*base, MediaType::TEXT) == baseText && base->getVersion() == baseVersion,
+           "training a clone leaves the original's weights alone");
+    expect(!sameWeights(*base, *copy, MediaType::TEXT), "the trained clone has its own weights");
+    expect(copy->getSectionWeights(MediaType::AUDIO).data() == base->getSectionWeights(MediaType::AUDIO).data(),
+           "sections the clone did not train stay shared");
+
+    // Each keeps its own snapshot history once the clone has trained
+    const unsigned int copyStep = copy->getVersion() - 1;
+    expect(base->getWeightSnapshot(baseStep, MediaType::TEXT) == baseSnapshot,
+           "the original's snapshots survive the clone training");
+    expect(base->getWeightSnapshot(copyStep, MediaType::TEXT).empty(),
+           "the clone's training steps stay out of the original's snapshots");
+    expect(copy->getWeightSnapshot(copyStep, MediaType::TEXT) == sectionBytes(*copy, MediaType::TEXT) &&
+           copy->getWeightSnapshot(baseStep, MediaType::TEXT) == baseSnapshot,
+           "the clone's snapshots cover both histories");
+
+    // Training the original leaves an earlier clone alone too
+    auto frozen = base->clone();
+    base->train();
+    expect(sectionBytes(*frozen, MediaType::TEXT) == baseText && frozen->getVersion() == baseVersion,
+           "training the original leaves its clone alone");
+
+    // Media configuration is copied on change as well
+    MediaProperties props = copy->getMediaProperties(MediaType::AUDIO);
+    const size_t audioBytes = frozen->sectionWeightBytes(MediaType::AUDIO);
+    props.outputSize = 2;
+    copy->configureMediaProperties(MediaType::AUDIO, props);
+    expect(frozen->getMediaProperties(MediaType::AUDIO).outputSize == 1 &&
+           frozen->sectionWeightBytes(MediaType::AUDIO) == audioBytes &&
+           copy->sectionWeightBytes(MediaType::AUDIO) == 2 * audioBytes,
+           "reconfiguring a clone leaves the original's layout alone");
+    std::cout << "Original at version " << baseVersion << " unchanged by a clone at version "
+              << copy->getVersion() << "\n";
+}
+
+bool sameRecord(const ModelRecord& a, const ModelRecord& b) {
+    return a.id == b.id && a.name == b.name && a.version == b.version && a.accuracy == b.accuracy &&
+           a.mediaTypes == b.mediaTypes && a.validated == b.validated;
+}
+
+void testModelCatalog() {
+    std::cout << "\nTesting Model Catalog Persistence...\n";
+    printSeparator();
+
+    ScratchDirectory scratch("catalog");
+    const std::string catalogPath = "catalog/models.catalog";
+    std::vector<std::shared_ptr<AIModel>> models;
+    std::string removedId;
+    {
+        ModelStorage storage(catalogPath);
+        const std::vector<MediaType> typeSets[] = {
+            {MediaType::TEXT}, {MediaType::IMAGE, MediaType::AUDIO}, {MediaType::VIDEO},
+            {MediaType::TEXT, MediaType::AUDIO}, {MediaType::AUDIO},
+        };
+        for (size_t i = 0; i < std::size(typeSets); ++i) {
+            models.push_back(makeTinyModel("Catalog-Mock-" + std::to_string(i), typeSets[i], 1));
+            storage.storeModel(models.back());
+        }
+        expect(storage.size() == models.size(), "storage holds every stored model");
+        expect(storage.getModel(models[2]->getId()) == models[2], "lookups return the stored handle");
+
+        // A new version replaces the entry and its metadata
+        auto next = models[1]->clone();
+        next->train();
+        expect(storage.updateModel(next), "updating a stored model succeeds");
+        models[1] = next;
+        expect(storage.getRecord(next->getId())->version == next->getVersion(),
+               "an update refreshes the record");
+        expect(!storage.updateModel(makeTinyModel("Unstored-Mock", {MediaType::TEXT}, 0)),
+               "updating an unknown model fails");
+
+        removedId = models[0]->getId();
+        expect(storage.removeModel(removedId) && !storage.contains(removedId), "a removed model is gone");
+        models.erase(models.begin());
+        storage.saveCatalog();
+    }
+
+    // A restarted catalog knows every model but holds none of them resident
+    ModelStorage reloaded(catalogPath);
+    expect(reloaded.size() == models.size() && !reloaded.contains(removedId),
+           "the reloaded catalog has exactly the saved models");
+    for (const auto& model : models) {
+        auto record = reloaded.getRecord(model->getId());
+        expect(record && sameRecord(*record, ModelRecord::describe(*model)),
+               "a reloaded record matches its model");
+        expect(reloaded.getModel(model->getId()) == nullptr, "a reloaded model is not resident");
+    }
+    expect(reloaded.listModels().empty() && reloaded.listRecords(0, SIZE_MAX).size() == models.size(),
+           "listing a reloaded catalog yields records only");
+
+    reloaded.storeModel(models[0]);
+    expect(reloaded.getModel(models[0]->getId()) == models[0] && reloaded.size() == models.size(),
+           "storing a catalogued model makes it resident again");
+
+    {
+        std::fstream file(catalogPath, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(20);
+        file.put('\x7F');
+    }
+    bool rejected = false;
+    try {
+        ModelStorage damaged(catalogPath);
+    } catch (const std::runtime_error& e) {
+        rejected = std::string(e.what()).find("checksum") != std::string::npos;
+    }
+    expect(rejected, "a corrupted catalog is rejected");
+    std::cout << "Reloaded " << reloaded.size() << " catalog records\n";
+}
+
+// What findRecords must return, worked out by scanning every record
+std::vector<ModelRecord> scanRecords(const ModelStorage& storage, const ModelQuery& query) {
+    std::vector<ModelRecord> all = storage.listRecords(0, SIZE_MAX);
+    auto latest = [&](const ModelRecord& record) {
+        return std::none_of(all.begin(), all.end(), [&](const ModelRecord& other) {
+            return other.name == record.name &&
+                   std::make_pair(other.version, other.id) > std::make_pair(record.version, record.id);
+        });
+    };
+    std::vector<ModelRecord> matches;
+    for (const auto& record : all) {
+        if ((record.mediaTypes & query.mediaTypes) == query.mediaTypes &&
+            record.accuracy >= query.minAccuracy && record.accuracy <= query.maxAccuracy &&
+            (!query.validatedOnly || record.validated) &&
+            (query.name.empty() || record.name == query.name) &&
+            (!query.latestOnly || latest(record))) {
+            matches.push_back(record);
+        }
+    }
+    std::stable_sort(matches.begin(), matches.end(), [](const ModelRecord& a, const ModelRecord& b) {
+        return a.accuracy > b.accuracy;
+    });
+    size_t begin = std::min(query.offset, matches.size());
+    size_t end = begin + std::min(query.limit, matches.size() - begin);
+    return std::vector<ModelRecord>(matches.begin() + begin, matches.begin() + end);
+}
+
+void testCatalogQueries() {
+    std::cout << "\nTesting Catalog Queries...\n";
+    printSeparator();
+
+    // Three names with several versions each, spread over the media types;
+    // every model is trained so accuracies differ
+    ModelStorage storage;
+    const std::vector<MediaType> typeSets[] = {
+        {MediaType::TEXT}, {MediaType::TEXT, MediaType::IMAGE}, {MediaType::AUDIO},
+        {MediaType::IMAGE, MediaType::VIDEO}, {MediaType::TEXT, MediaType::AUDIO, MediaType::VIDEO},
+    };
+    std::vector<std::string> ids;
+    for (int i = 0; i < 15; ++i) {
+        auto model = makeTinyModel("Query-Mock-" + std::to_string(i % 3), typeSets[i % 5], 0);
+        // An untrained model validates trivially and keeps the flag when trained
+        if (i % 4 == 0) model->validate();
+        for (int step = 0; step <= i % 4; ++step) {
+            model->train();
+        }
+        storage.storeModel(model);
+        ids.push_back(model->getId());
+    }
+
+    auto flags = [](std::initializer_list<MediaType> types) {
+        uint32_t bits = 0;
+        for (MediaType type : types) bits |= static_cast<uint32_t>(type);
+        return bits;
+    };
+    std::vector<ModelQuery> queries(9);
+    queries[1].mediaTypes = flags({MediaType::TEXT});
+    queries[2].mediaTypes = flags({MediaType::TEXT, MediaType::AUDIO});
+    queries[3].minAccuracy = 0.05;
+    queries[3].maxAccuracy = 0.15;
+    queries[4].mediaTypes = flags({MediaType::IMAGE});
+    queries[4].minAccuracy = 0.02;
+    queries[5].name = "Query-Mock-1";
+    queries[6].latestOnly = true;
+    queries[7].validatedOnly = true;
+    queries[7].mediaTypes = flags({MediaType::VIDEO});
+    queries[8].offset = 3;
+    queries[8].limit = 4;
+
+    auto checkQueries = [&](const std::string& when) {
+        for (size_t i = 0; i < queries.size(); ++i) {
+            std::vector<ModelRecord> expected = scanRecords(storage, queries[i]);
+            std::vector<ModelRecord> found = storage.findRecords(queries[i]);
+            bool same = found.size() == expected.size() &&
+                        std::equal(found.begin(), found.end(), expected.begin(), sameRecord);
+            expect(same, "query " + std::to_string(i) + " matches a full scan " + when);
+            ModelQuery unpaged = queries[i];
+            unpaged.offset = 0;
+            unpaged.limit = SIZE_MAX;
+            expect(storage.countMatching(unpaged) == scanRecords(storage, unpaged).size(),
+                   "query " + std::to_string(i) + " counts what it finds " + when);
+        }
+    };
+    checkQueries("after inserts");
+
+    // Removal moves the last catalog entry into the freed position, which
+    // the media type bitmaps have to follow
+    storage.removeModel(ids[4]);
+    storage.removeModel(ids[0]);
+    checkQueries("after removals");
+
+    auto latest = storage.getLatestVersion("Query-Mock-2");
+    ModelQuery byName;
+    byName.name = "Query-Mock-2";
+    byName.latestOnly = true;
+    std::vector<ModelRecord> newest = storage.findRecords(byName);
+    expect(latest && newest.size() == 1 && newest[0].id == latest->id,
+           "the latest version is the only latestOnly match for its name");
+    std::cout << "Checked " << queries.size() << " queries against a full scan of "
+              << storage.size() << " models\n";
+}
+
+void testModelCache() {
+    std::cout << "\nTesting Model Cache Eviction...\n";
+    printSeparator();
+
+    // Every model is a trained one-output TEXT model of 50000 bytes, so the
+    // budget holds two of them
+    const size_t modelBytes = 50000;
+    std::mutex loadsMutex;
+    std::map<std::string, int> loads;
+    ModelStorage storage;
+    ModelCache cache(storage, 2 * modelBytes + modelBytes / 2, [&](const std::string& id) {
+        if (id == "missing") {
+            throw std::runtime_error("No such model: " + id);
+        }
+        {
+            std::lock_guard<std::mutex> lock(loadsMutex);
+            loads[id]++;
+        }
+        return ModelHandle(makeTinyModel(id, {MediaType::TEXT}, 1));
+    });
+    auto loadCount = [&](const std::string& id) {
+        std::lock_guard<std::mutex> lock(loadsMutex);
+        return loads[id];
+    };
+
+    cache.pin("a").release();
+    cache.pin("b").release();
+    expect(cache.getStats().residentBytes == 2 * modelBytes, "models are charged their weight bytes");
+    cache.pin("a").release();
+    cache.pin("c").release();
+    expect(cache.contains("a") && !cache.contains("b") && cache.contains("c"),
+           "the least recently used model is evicted first");
+    expect(loadCount("a") == 1, "a hit does not reload the model");
+
+    // Pinned models stay resident past the budget until their pins go
+    {
+        ModelCache::Pin a = cache.pin("a");
+        ModelCache::Pin c = cache.pin("c");
+        ModelCache::Pin d = cache.pin("d");
+        expect(cache.contains("a") && cache.contains("c") && cache.contains("d"),
+               "pinned models are never evicted");
+        expect(cache.getStats().residentBytes == 3 * modelBytes, "pins may exceed the budget");
+        expect(!cache.invalidate("c"), "a pinned model cannot be invalidated");
+        expect(a->getName() == "a", "a pin gives access to its model");
+
+        a.release();
+        expect(!cache.contains("a") && cache.getStats().residentBytes == 2 * modelBytes,
+               "releasing a pin restores the budget");
+    }
+    expect(cache.invalidate("c") && !cache.contains("c"), "an unpinned model can be invalidated");
+
+    cache.pin("b").release();
+    expect(loadCount("b") == 2, "an evicted model is loaded again");
+
+    bool failed = false;
+    try {
+        cache.pin("missing");
+    } catch (const std::runtime_error&) {
+        failed = true;
+    }
+    ModelCacheStats stats = cache.getStats();
+    expect(failed && !cache.contains("missing") && stats.loadFailures == 1,
+           "a failed load is reported and not cached");
+    expect(stats.residentBytes <= cache.getBudget(), "the cache ends within its budget");
+    std::cout << "Hits: " << stats.hits << ", misses: " << stats.misses
+              << ", evictions: " << stats.evictions << ", resident: " << stats.residentBytes << " bytes\n";
+}
+
+AgentContext textJob(const std::string& text) {
+    return AgentContext{.mediaType = MediaType::TEXT, .payload = AgentPayload(text), .parameters = {}};
+}
+
+void testAgentRuntime() {
+    std::cout << "\nTesting Agent Runtime Scheduling...\n";
+    printSeparator();
+
+    AgentRuntimeConfig config;
+    config.workers = 4;
+    AgentRuntime runtime(config);
+    auto model = makeTinyModel("Runtime-Mock", {MediaType::TEXT}, 1);
+    const std::string id = model->getId();
+    const unsigned int initialVersion = model->getVersion();
+    runtime.addModel(model);
+
+    // TRAIN jobs of one model run one at a time, so none of them is lost;
+    // PROCESS jobs interleave with them against whatever version is current
+    const unsigned int steps = 12;
+    std::vector<std::future<AgentOutcome>> trains;
+    std::vector<std::future<AgentOutcome>> processes;
+    for (unsigned int i = 0; i < steps; ++i) {
+        trains.push_back(runtime.submit(id, textJob("training sample " + std::to_string(i)), AgentAction::TRAIN));
+        processes.push_back(runtime.submit(id, textJob("process me"), AgentAction::PROCESS));
+    }
+    runtime.waitIdle();
+
+    std::set<unsigned int> produced;
+    for (auto& train : trains) {
+        AgentOutcome outcome = train.get();
+        expect(outcome.success && outcome.action == AgentAction::TRAIN, "every TRAIN step succeeds");
+        produced.insert(outcome.modelVersion);
+    }
+    expect(produced.size() == steps && *produced.begin() == initialVersion + 1 &&
+           *produced.rbegin() == initialVersion + steps,
+           "TRAIN steps each produce the next version");
+    for (auto& process : processes) {
+        AgentOutcome outcome = process.get();
+        expect(outcome.action == AgentAction::PROCESS && outcome.modelVersion >= initialVersion &&
+               outcome.modelVersion <= initialVersion + steps,
+               "PROCESS runs against a published version");
+    }
+    expect(runtime.getModel(id)->getVersion() == initialVersion + steps,
+           "the runtime publishes the last TRAIN step");
+    expect(model->getVersion() == initialVersion, "training never modifies a published model");
+
+    AgentRuntimeStats stats = runtime.getStats();
+    expect(stats.submitted == 2 * steps && stats.executed == 2 * steps && stats.cancelled == 0,
+           "every submitted job runs exactly once");
+    expect(stats.byAction[static_cast<size_t>(AgentAction::TRAIN)] == steps,
+           "the runtime counts TRAIN steps");
+
+    bool unknown = false;
+    try {
+        runtime.submit("no-such-model", textJob("lost"), AgentAction::PROCESS).get();
+    } catch (const std::invalid_argument&) {
+        unknown = true;
+    }
+    expect(unknown, "a job for an unknown model fails");
+    std::cout << "Ran " << stats.executed << " jobs on " << runtime.workerCount() << " workers, "
+              << stats.steals << " stolen\n";
+}
+
+// True if the job failed with AgentCancelled for the expected reason
+bool wasCancelled(std::future<AgentOutcome>& result, bool deadline) {
+    try {
+        result.get();
+    } catch (const AgentCancelled& e) {
+        return e.deadlineExceeded() == deadline;
+    }
+    return false;
+}
+
+void testAgentCancellation() {
+    std::cout << "\nTesting Agent Job Cancellation...\n";
+    printSeparator();
+
+    AgentRuntimeConfig config;
+    config.workers = 2;
+    AgentRuntime runtime(config);
+    auto model = makeTinyModel("Cancel-Mock", {MediaType::TEXT}, 1);
+    const std::string id = model->getId();
+    const unsigned int initialVersion = model->getVersion();
+    runtime.addModel(model);
+
+    AgentJobOptions train;
+    train.action = AgentAction::TRAIN;
+    CancellationToken token;
+    token.cancel();
+    AgentJobOptions cancelledTrain = train;
+    cancelledTrain.cancellation = token;
+    AgentJobOptions lateTrain = train;
+    lateTrain.deadline = std::chrono::steady_clock::now() - std::chrono::milliseconds(1);
+    AgentJobOptions lateProcess = lateTrain;
+    lateProcess.action = AgentAction::PROCESS;
+
+    // Aborted TRAIN steps sit between good ones on the model's TRAIN strand
+    auto first = runtime.submit(id, textJob("first"), train);
+    auto cancelled = runtime.submit(id, textJob("cancelled"), cancelledTrain);
+    auto late = runtime.submit(id, textJob("late"), lateTrain);
+    auto second = runtime.submit(id, textJob("second"), train);
+    auto lateRead = runtime.submit(id, textJob("late read"), lateProcess);
+    runtime.waitIdle();
+
+    expect(wasCancelled(cancelled, false), "a cancelled job fails with AgentCancelled");
+    expect(wasCancelled(late, true), "a late TRAIN job reports its missed deadline");
+    expect(wasCancelled(lateRead, true), "a late PROCESS job reports its missed deadline");
+    expect(first.get().success && second.get().success, "jobs around aborted ones still run");
+    expect(runtime.getModel(id)->getVersion() == initialVersion + 2,
+           "aborted TRAIN steps leave the model unchanged");
+
+    AgentRuntimeStats stats = runtime.getStats();
+    expect(stats.cancelled == 3 && stats.deadlineMisses == 2 && stats.executed == 2,
+           "aborted jobs are counted and never executed");
+
+    // A live token and a distant deadline do not get in the way
+    CancellationToken live;
+    AgentJobOptions guarded = train;
+    guarded.cancellation = live;
+    guarded.deadline = std::chrono::steady_clock::now() + std::chrono::minutes(1);
+    AgentOutcome outcome = runtime.submit(id, textJob("guarded"), guarded).get();
+    live.cancel();
+    expect(outcome.success && outcome.modelVersion == initialVersion + 3 &&
+           runtime.getModel(id)->getVersion() == initialVersion + 3,
+           "a job finished before its token is cancelled keeps its result");
+    std::cout << "Cancelled " << stats.cancelled << " jobs, " << stats.deadlineMisses
+              << " of them past their deadline\n";
+}
+
+bool sameDecisions(const std::vector<DecisionRecord>& a, const std::vector<DecisionRecord>& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const auto& x, const auto& y) {
+        return x.action == y.action && x.mediaType == y.mediaType && x.success == y.success &&
+               x.inputSize == y.inputSize;
+    });
+}
+
+void testAgentState() {
+    std::cout << "\nTesting Agent State Persistence...\n";
+    printSeparator();
+
+    ScratchDirectory scratch("agent-state");
+    auto model = makeTinyModel("State-Mock", {MediaType::TEXT}, 1);
+    AgentStateOptions options;
+    options.path = "agents/State-Mock.agent";
+    options.flushInterval = 0;
+
+    std::vector<DecisionRecord> history;
+    std::array<double, 4> scores;  // one per AgentAction
+    {
+        ModelAgent agent(model, nullptr, options);
+        expect(!agent.restoredState(), "an agent without a snapshot starts cold");
+        agent.processContext(textJob("first sample"));
+        agent.processContext(textJob("second, longer sample"));
+        agent.learn(textJob("feedback"), "good results");
+        history = agent.getDecisionHistory();
+        for (size_t i = 0; i < scores.size(); ++i) {
+            scores[i] = agent.evaluateAction(static_cast<AgentAction>(i), textJob("probe"));
+        }
+    }
+
+    // Writes bytes as the snapshot and reports whether a new agent took it
+    auto restores = [&](const std::vector<uint8_t>& bytes) {
+        utils::saveBinaryFile(options.path, bytes);
+        ModelAgent agent(model, nullptr, options);
+        return agent.restoredState();
+    };
+    // The snapshot ends with a checksum of everything before it
+    auto withChecksum = [](std::vector<uint8_t> bytes) {
+        uint64_t sum = utils::checksum64(bytes.data(), bytes.size() - sizeof(sum));
+        std::memcpy(bytes.data() + bytes.size() - sizeof(sum), &sum, sizeof(sum));
+        return bytes;
+    };
+
+    {
+        ModelAgent agent(model, nullptr, options);
+        bool sameScores = true;
+        for (size_t i = 0; i < scores.size(); ++i) {
+            sameScores = sameScores &&
+                         agent.evaluateAction(static_cast<AgentAction>(i), textJob("probe")) == scores[i];
+        }
+        expect(agent.restoredState() && history.size() == 2 && sameDecisions(agent.getDecisionHistory(), history),
+               "a restored agent has the saved decision history");
+        expect(sameScores, "a restored agent has the saved action scores");
+    }
+
+    utils::FileBuffer file = utils::loadFile(options.path);
+    const std::vector<uint8_t> saved(file.data(), file.data() + file.size());
+    // magic[8] | version u32 | action count u32 | scores f64[4] | history size u32 | records
+    const size_t versionOffset = 8;
+    const size_t firstMediaType = 8 + 4 + 4 + 4 * 8 + 4 + 1;
+
+    std::vector<uint8_t> flipped = saved;
+    flipped[versionOffset + 10] ^= 0x40;
+    expect(!restores(flipped), "a snapshot with a flipped byte fails its checksum");
+
+    std::vector<uint8_t> version = saved;
+    version[versionOffset]++;
+    expect(!restores(withChecksum(version)), "a snapshot of another format version is ignored");
+
+    std::vector<uint8_t> mediaType = saved;
+    mediaType[firstMediaType] = 3;
+    expect(!restores(withChecksum(mediaType)), "a snapshot with an invalid media type is ignored");
+
+    expect(!restores(std::vector<uint8_t>(saved.begin(), saved.end() - 12)), "a short snapshot is ignored");
+    expect(!restores(std::vector<uint8_t>(saved.begin(), saved.begin() + 6)), "a truncated header is ignored");
+    expect(restores(saved), "the unmodified snapshot still restores");
+    std::cout << "Restored " << history.size() << " decisions from " << saved.size() << " bytes\n";
+}
+
+void testDecisionHistory() {
+    std::cout << "\nTesting Decision History Ring...\n";
+    printSeparator();
+
+    ScratchDirectory scratch("decision-history");
+    auto model = makeTinyModel("History-Mock", {MediaType::TEXT}, 1);
+    AgentStateOptions options;
+    options.path = "agents/History-Mock.agent";
+    options.flushInterval = 0;
+
+    // Past the agent's capacity of 1000 records the oldest are overwritten;
+    // input sizes number the records so the survivors can be told apart
+    const size_t capacity = 1000;
+    const size_t recorded = capacity + 250;
+    auto actionOf = [](size_t i) { return i % 2 ? AgentAction::PROCESS : AgentAction::TRAIN; };
+    auto successOf = [](size_t i) { return i % 3 != 0; };
+    std::vector<DecisionRecord> history;
+    {
+        ModelAgent agent(model, nullptr, options);
+        for (size_t i = 0; i < recorded; ++i) {
+            agent.recordOutcome(actionOf(i), textJob(std::string(i + 1, 'h')), successOf(i));
+        }
+        history = agent.getDecisionHistory();
+        bool inOrder = history.size() == capacity;
+        for (size_t i = 0; inOrder && i < capacity; ++i) {
+            inOrder = history[i].inputSize == recorded - capacity + i + 1;
+        }
+        expect(inOrder, "the ring keeps the newest records, oldest first");
+
+        size_t trainSuccesses = 0;
+        for (size_t i = recorded - capacity; i < recorded; ++i) {
+            trainSuccesses += actionOf(i) == AgentAction::TRAIN && successOf(i);
+        }
+        expect(agent.getSuccessRate(AgentAction::TRAIN) == trainSuccesses / static_cast<double>(capacity),
+               "success rates count only the records still in the ring");
+    }
+
+    // A wrapped ring is saved oldest first and restored in the same order
+    ModelAgent restored(model, nullptr, options);
+    expect(restored.restoredState() && sameDecisions(restored.getDecisionHistory(), history),
+           "a wrapped history survives a save and restore");
+    restored.recordOutcome(AgentAction::WAIT, textJob("newest"), true);
+    std::vector<DecisionRecord> after = restored.getDecisionHistory();
+    expect(after.size() == capacity && after.front().inputSize == history[1].inputSize &&
+           after.back().action == AgentAction::WAIT,
+           "a restored ring keeps wrapping");
+    std::cout << "Kept " << history.size() << " of " << recorded << " decisions\n";
+}
+
+void testAgentBatches() {
+    std::cout << "\nTesting Agent Minibatches...\n";
+    printSeparator();
+
+    auto model = makeTinyModel("Batch-Mock", {MediaType::TEXT, MediaType::AUDIO}, 1);
+    auto before = model->clone();
+    ModelAgent agent(model);
+
+    // A mixed batch trains each media type; the empty context is rejected
+    std::vector<AgentContext> batch = {
+        textJob("first text sample"),
+        AgentContext{.mediaType = MediaType::AUDIO,
+                     .payload = AgentPayload(std::vector<uint8_t>(4096, 7)),
+                     .parameters = {}},
+        textJob("second text sample"),
+        textJob(""),
+    };
+    expect(agent.processBatch(batch) == 3, "processBatch handles every valid context");
+    std::vector<DecisionRecord> history = agent.getDecisionHistory();
+    std::set<MediaType> logged;
+    for (const DecisionRecord& record : history) {
+        logged.insert(record.mediaType);
+    }
+    expect(logged == std::set<MediaType>{MediaType::TEXT, MediaType::AUDIO},
+           "each media type of a mixed batch gets its own decision");
+    expect(history.size() == 2 && history[0].action == AgentAction::TRAIN &&
+           history[0].inputSize == batch[0].payload.size() + batch[2].payload.size(),
+           "a trained minibatch is logged once with its total size");
+    expect(!sameWeights(*before, *model, MediaType::TEXT) && !sameWeights(*before, *model, MediaType::AUDIO),
+           "each media type of a mixed batch is trained");
+    std::cout << "Handled " << logged.size() << " media types in one batch\n";
+
+    // A streamed file is trained through the agent, and the update does not
+    // depend on how the stream was chunked
+    ScratchDirectory scratch("stream");
+    std::vector<uint8_t> audio(100000);
+    for (size_t i = 0; i < audio.size(); ++i) {
+        audio[i] = static_cast<uint8_t>(i * 31 + i / 251);
+    }
+    utils::saveBinaryFile("sample.raw", audio);
+    utils::Checksum64 pieces;
+    pieces.update(audio.data(), 7);
+    pieces.update(audio.data() + 7, 4000);
+    pieces.update(audio.data() + 4007, audio.size() - 4007);
+    expect(pieces.digest() == utils::checksum64(audio.data(), audio.size()),
+           "a checksum over pieces matches the one over the whole");
+
+    auto base = makeTinyModel("Stream-Mock", {MediaType::AUDIO}, 1);
+    std::vector<std::shared_ptr<AIModel>> streamed;
+    for (size_t chunkSize : {size_t(1000), size_t(4096)}) {
+        auto target = base->clone();
+        ModelAgent streamAgent(target);
+        AgentContext context{
+            .mediaType = MediaType::AUDIO,
+            .payload = AgentPayload(std::make_shared<FileMediaReader>("sample.raw")),
+            .parameters = {{"mode", "training"}, {"chunk_size", std::to_string(chunkSize)}}
+        };
+        streamAgent.processContext(context);
+        std::vector<DecisionRecord> decisions = streamAgent.getDecisionHistory();
+        expect(decisions.size() == 1 && decisions[0].action == AgentAction::TRAIN && decisions[0].success &&
+               decisions[0].inputSize == audio.size(),
+               "a streamed file is trained through the agent");
+        streamed.push_back(target);
+    }
+    expect(!sameWeights(*base, *streamed[0], MediaType::AUDIO), "a streamed file updates the weights");
+    expect(sameWeights(*streamed[0], *streamed[1], MediaType::AUDIO),
+           "streamed training gives the same weights for any chunk size");
+}
+
 void runTests() {
     std::cout << "Running Enhanced AI Model Marketplace Tests...\n";
     BlockchainLedger ledger;
@@ -459,39 +1745,40 @@ void runTests() {
         MediaType::AUDIO,
         MediaType::VIDEO
     };
-    AIModel model("Universal-Mock", allTypes);
+    auto model = std::make_shared<AIModel>("Universal-Mock", allTypes);
+    useTestVideoLayout(*model);
 
     storage.storeModel(model);
-    ledger.addTransaction("CREATE", model.getId(), "system", "", 0.0);
+    ledger.addTransaction("CREATE", model->getId(), "system", "", 0.0);
     std::cout << "Created multi-modal model successfully (Initial version: "
-              << model.getVersion() << ")\n";
+              << model->getVersion() << ")\n";
 
     printSeparator();
     std::cout << "Test 2: Training and version updates...\n";
     for (int i = 0; i < 3; i++) {
-        model.train();
+        model->train();
         storage.updateModel(model);
         std::cout << "Training iteration " << (i + 1)
-                  << " completed. Version: " << model.getVersion()
+                  << " completed. Version: " << model->getVersion()
                   << ", Accuracy: " << std::fixed << std::setprecision(4)
-                  << model.getAccuracy() << std::endl; 
-        std::cout << "Debug: Model internal state after iteration " << i + 1 << ": " << model.getDebugInfo() << std::endl; 
+                  << model->getAccuracy() << std::endl; 
+        std::cout << "Debug: Model internal state after iteration " << i + 1 << ": " << model->getDebugInfo() << std::endl; 
     }
 
     printSeparator();
     std::cout << "Test 3: Testing collaborative training...\n";
     std::vector<std::string> contributors = {"alice", "bob", "charlie"};
     std::vector<double> contributions = {10.5, 8.3, 15.2}; 
-    ledger.addCollaborativeTransaction(model.getId(), contributors, contributions);
+    ledger.addCollaborativeTransaction(model->getId(), contributors, contributions);
     std::cout << "Collaborative training session recorded\n";
 
     printSeparator();
     std::cout << "Test 4: Testing community voting system...\n";
-    ledger.addVote(model.getId(), "user1", 5, "Excellent performance!");
-    ledger.addVote(model.getId(), "user2", 4, "Good but could be better");
-    ledger.addVote(model.getId(), "user3", 5, "Revolutionary!");
+    ledger.addVote(model->getId(), "user1", 5, "Excellent performance!");
+    ledger.addVote(model->getId(), "user2", 4, "Good but could be better");
+    ledger.addVote(model->getId(), "user3", 5, "Revolutionary!");
 
-    double rating = ledger.getModelRating(model.getId());
+    double rating = ledger.getModelRating(model->getId());
     std::cout << "Model average rating: " << rating << "/5.0\n";
 
     printSeparator();
@@ -504,7 +1791,7 @@ void runTests() {
 
     printSeparator();
     std::cout << "Test 6: Testing fair pricing mechanism...\n";
-    double fairPrice = ledger.calculateFairPrice(model.getId());
+    double fairPrice = ledger.calculateFairPrice(model->getId());
     std::cout << "Calculated fair price: " << fairPrice << " tokens\n";
 
     printSeparator();
@@ -522,13 +1809,13 @@ void runTests() {
     std::cout << "Test 8: Testing rental with reputation...\n";
     const std::string renter = "dave";
     const std::string owner = "alice";
-    const double rentalPrice = ledger.calculateFairPrice(model.getId()) * 0.1; 
+    const double rentalPrice = ledger.calculateFairPrice(model->getId()) * 0.1; 
     const time_t rentalDuration = 24 * 3600; 
 
-    ledger.addTransaction("RENT", model.getId(), renter, owner,
+    ledger.addTransaction("RENT", model->getId(), renter, owner,
                          rentalPrice, rentalDuration);
 
-    if (ledger.isModelRentedBy(model.getId(), renter)) {
+    if (ledger.isModelRentedBy(model->getId(), renter)) {
         std::cout << "Model successfully rented to " << renter
                   << " for 24 hours at " << rentalPrice << " tokens\n";
     }
@@ -536,12 +1823,12 @@ void runTests() {
     printSeparator();
     std::cout << "Test 9: Testing documentation system...\n";
     std::vector<std::string> tags = {"tutorial", "best-practices", "training"};
-    ledger.addDocumentation(model.getId(), "expert1",
+    ledger.addDocumentation(model->getId(), "expert1",
                             "Comprehensive guide to training this model effectively.", tags);
-    ledger.upvoteDocumentation(model.getId(), "user1");
-    ledger.addDocComment(model.getId(), "user2", "Very helpful guide!");
+    ledger.upvoteDocumentation(model->getId(), "user1");
+    ledger.addDocComment(model->getId(), "user2", "Very helpful guide!");
 
-    auto docs = ledger.getModelDocs(model.getId());
+    auto docs = ledger.getModelDocs(model->getId());
     std::cout << "Documentation entries: " << docs.size()
               << ", Upvotes: " << docs[0].upvotes
               << ", Comments: " << docs[0].comments.size() << "\n";
@@ -556,30 +1843,30 @@ void runTests() {
         .validations = std::vector<std::string>(),
         .lastAudit = std::time(nullptr)
     };
-    ledger.updateQualityMetrics(model.getId(), metrics);
-    ledger.validateModel(model.getId(), "validator1");
+    ledger.updateQualityMetrics(model->getId(), metrics);
+    ledger.validateModel(model->getId(), "validator1");
 
-    auto quality = ledger.getModelQuality(model.getId());
+    auto quality = ledger.getModelQuality(model->getId());
     std::cout << "Model quality metrics - Accuracy: " << quality.accuracy
               << ", Reliability: " << quality.reliability
               << ", Validations: " << quality.validations.size() << "\n";
 
     printSeparator();
     std::cout << "Test 11: Testing advanced reward distribution...\n";
-    ledger.distributeRewards(model.getId(), 1000.0); 
+    ledger.distributeRewards(model->getId(), 1000.0); 
 
     for (const auto& contributor : {"alice", "bob", "charlie"}) {
-        double reward = ledger.calculateUserReward(contributor, model.getId());
+        double reward = ledger.calculateUserReward(contributor, model->getId());
         std::cout << "Reward for " << contributor << ": " << reward << " tokens\n";
     }
 
     printSeparator();
     std::cout << "Test 12: Testing resource optimization...\n";
     ResourceUsage usage{120.5, 48.3, 256.0, 1024.0, 500.0};
-    ledger.trackResourceUsage(model.getId(), usage);
+    ledger.trackResourceUsage(model->getId(), usage);
 
-    double efficiency = ledger.optimizeResourceAllocation(model.getId());
-    auto optimizedUsage = ledger.getResourceMetrics(model.getId());
+    double efficiency = ledger.optimizeResourceAllocation(model->getId());
+    auto optimizedUsage = ledger.getResourceMetrics(model->getId());
     std::cout << "Resource efficiency score: " << efficiency
               << "\nOptimized cost: " << optimizedUsage.costTokens << " tokens\n";
 
@@ -587,13 +1874,13 @@ void runTests() {
     std::cout << "Test 13: Testing version control system...\n";
     ModelVersion version{1, utils::hashString("v1"), "", std::time(nullptr),
                          "Initial release", true};
-    ledger.addModelVersion(model.getId(), version);
+    ledger.addModelVersion(model->getId(), version);
 
-    if (ledger.rollbackVersion(model.getId(), 1)) {
+    if (ledger.rollbackVersion(model->getId(), 1)) {
         std::cout << "Successfully rolled back to version 1\n";
     }
 
-    auto history = ledger.getVersionHistory(model.getId());
+    auto history = ledger.getVersionHistory(model->getId());
     std::cout << "Version history entries: " << history.size() << "\n";
 
     printSeparator();
@@ -610,6 +1897,40 @@ void runTests() {
     printSeparator();
     std::cout << "\nTesting Agent Capabilities:\n";
     testAgentCapabilities();
+    printSeparator();
+    testSpanProcessing();
+    printSeparator();
+    testBatchScheduler();
+    printSeparator();
+    testFileIO();
+    printSeparator();
+    testBatchTrainingOrder();
+    printSeparator();
+    testCopyOnWrite();
+    printSeparator();
+    testWeightLayout();
+    printSeparator();
+    testRandomFill();
+    printSeparator();
+    testDocumentStream();
+    printSeparator();
+    testWeightEncodings();
+    printSeparator();
+    testModelCatalog();
+    printSeparator();
+    testCatalogQueries();
+    printSeparator();
+    testModelCache();
+    printSeparator();
+    testAgentRuntime();
+    printSeparator();
+    testAgentCancellation();
+    printSeparator();
+    testAgentState();
+    printSeparator();
+    testDecisionHistory();
+    printSeparator();
+    testAgentBatches();
 }
 
 int main(int argc, char* argv[]) {
@@ -619,4 +1940,4 @@ int main(int argc, char* argv[]) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
-}
\ No newline at end of file
+}
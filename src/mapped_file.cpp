@@ -0,0 +1,92 @@
+#include "mapped_file.hpp"
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+    int toMadvise(MapAdvice advice) {
+        switch (advice) {
+            case MapAdvice::SEQUENTIAL: return MADV_SEQUENTIAL;
+            case MapAdvice::RANDOM: return MADV_RANDOM;
+            case MapAdvice::WILLNEED: return MADV_WILLNEED;
+            case MapAdvice::NORMAL: break;
+        }
+        return MADV_NORMAL;
+    }
+
+    std::runtime_error mapError(const std::string& what, const std::string& path) {
+        return std::runtime_error(what + " '" + path + "': " + std::strerror(errno));
+    }
+}
+
+MappedFile::MappedFile(const std::string& path, const std::uint8_t* base, std::size_t length)
+    : path(path), base(base), length(length) {
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path, const MapOptions& options) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw mapError("Failed to open", path);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw mapError("Failed to stat", path);
+    }
+
+    std::size_t length = static_cast<std::size_t>(st.st_size);
+    if (length == 0) {
+        // mmap() rejects zero-length mappings; an empty file maps to nothing
+        ::close(fd);
+        return std::shared_ptr<MappedFile>(new MappedFile(path, nullptr, 0));
+    }
+
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    if (options.populate) flags |= MAP_POPULATE;
+#endif
+    void* addr = ::mmap(nullptr, length, PROT_READ, flags, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        throw mapError("Failed to map", path);
+    }
+
+    std::shared_ptr<MappedFile> file(
+        new MappedFile(path, static_cast<const std::uint8_t*>(addr), length));
+
+#ifdef MADV_HUGEPAGE
+    if (options.hugePages) {
+        // Best effort: only honoured where the kernel supports file-backed THP
+        ::madvise(addr, length, MADV_HUGEPAGE);
+    }
+#endif
+    if (options.advice != MapAdvice::NORMAL) {
+        file->advise(options.advice);
+    }
+    return file;
+}
+
+MappedFile::~MappedFile() {
+    if (base) {
+        ::munmap(const_cast<std::uint8_t*>(base), length);
+    }
+}
+
+void MappedFile::advise(MapAdvice advice, std::size_t offset, std::size_t rangeLength) const {
+    if (!base || offset >= length) return;
+    if (rangeLength == 0 || offset + rangeLength > length) {
+        rangeLength = length - offset;
+    }
+
+    // madvise() needs a page-aligned start address
+    static const std::size_t pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    std::size_t alignedOffset = offset - (offset % pageSize);
+    ::madvise(const_cast<std::uint8_t*>(base) + alignedOffset,
+              rangeLength + (offset - alignedOffset), toMadvise(advice));
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// Access pattern hints forwarded to madvise()
+enum class MapAdvice {
+    NORMAL,
+    SEQUENTIAL,
+    RANDOM,
+    WILLNEED
+};
+
+struct MapOptions {
+    MapAdvice advice = MapAdvice::NORMAL;
+    bool hugePages = false;     // request transparent huge pages for the mapping
+    bool populate = false;      // prefault all pages up front (MAP_POPULATE)
+};
+
+// Read-only, shared memory mapping of a whole file. Every process mapping the
+// same file shares one page-cache copy of its contents.
+class MappedFile {
+public:
+    static std::shared_ptr<MappedFile> open(const std::string& path,
+                                            const MapOptions& options = MapOptions());
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const std::uint8_t* data() const { return base; }
+    std::size_t size() const { return length; }
+    const std::string& getPath() const { return path; }
+
+    // Apply an access hint to a byte range (whole mapping when length is 0)
+    void advise(MapAdvice advice, std::size_t offset = 0, std::size_t rangeLength = 0) const;
+
+private:
+    MappedFile(const std::string& path, const std::uint8_t* base, std::size_t length);
+
+    std::string path;
+    const std::uint8_t* base;
+    std::size_t length;
+};
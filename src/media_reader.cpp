@@ -0,0 +1,51 @@
+#include "media_reader.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+FileMediaReader::FileMediaReader(const std::string& path)
+    : path(path), fd(-1), fileSize(0) {
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open '" + path + "': " + std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == 0) {
+        fileSize = static_cast<std::uint64_t>(st.st_size);
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    // Let the kernel read ahead aggressively; each byte is read exactly once
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+FileMediaReader::~FileMediaReader() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+std::size_t FileMediaReader::read(std::span<std::uint8_t> buffer) {
+    std::size_t total = 0;
+    while (total < buffer.size()) {
+        ssize_t n = ::read(fd, buffer.data() + total, buffer.size() - total);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Failed to read '" + path + "': " + std::strerror(errno));
+        }
+        if (n == 0) break;
+        total += static_cast<std::size_t>(n);
+    }
+    return total;
+}
+
+std::size_t MemoryMediaReader::read(std::span<std::uint8_t> buffer) {
+    std::size_t n = std::min(buffer.size(), data.size() - position);
+    std::copy_n(data.begin() + position, n, buffer.begin());
+    position += n;
+    return n;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <span>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// Sequential source of media bytes for streaming training
+class MediaReader {
+public:
+    virtual ~MediaReader() = default;
+
+    // Fills as much of buffer as possible; returns fewer bytes only at the end
+    // of the stream and 0 once it is exhausted. Throws std::runtime_error on I/O errors.
+    virtual std::size_t read(std::span<std::uint8_t> buffer) = 0;
+
+    // Total stream length when known up front, 0 otherwise
+    virtual std::uint64_t sizeHint() const { return 0; }
+};
+
+class FileMediaReader : public MediaReader {
+public:
+    explicit FileMediaReader(const std::string& path);
+    ~FileMediaReader() override;
+
+    FileMediaReader(const FileMediaReader&) = delete;
+    FileMediaReader& operator=(const FileMediaReader&) = delete;
+
+    std::size_t read(std::span<std::uint8_t> buffer) override;
+    std::uint64_t sizeHint() const override { return fileSize; }
+
+private:
+    std::string path;
+    int fd;
+    std::uint64_t fileSize;
+};
+
+class MemoryMediaReader : public MediaReader {
+public:
+    explicit MemoryMediaReader(std::span<const std::uint8_t> data) : data(data) {}
+
+    std::size_t read(std::span<std::uint8_t> buffer) override;
+    std::uint64_t sizeHint() const override { return data.size(); }
+
+private:
+    std::span<const std::uint8_t> data;
+    std::size_t position = 0;
+};
@@ -6,19 +6,39 @@
 #include <stdexcept>
 #include <iostream>
 #include "utils.hpp"
+#include "model_format.hpp"
+#include "kernels.hpp"
 #include <unordered_set>
 #include <map>
+#include <algorithm>
+#include <thread>
+#include "bounded_queue.hpp"
+#include <bit>
+#include <atomic>
+#include <iomanip>
 
 
 AIModel::AIModel(const std::string& name, const std::vector<MediaType>& types) 
     : name(name), accuracy(0.0), version(1), validated(false) {
     id = generateId();
-    supportedTypes.insert(types.begin(), types.end());
+    std::random_device rd;
+    seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+    auto config = std::make_shared<MediaConfig>();
+    config->supportedTypes.insert(types.begin(), types.end());
+    media = std::move(config);
     initializeMediaProperties();
 }
 
+AIModel::MediaConfig& AIModel::mutableMedia() {
+    auto copy = media ? std::make_shared<MediaConfig>(*media) : std::make_shared<MediaConfig>();
+    MediaConfig& config = *copy;
+    media = std::move(copy);
+    return config;
+}
+
 void AIModel::initializeMediaProperties() {
-    for (const auto& type : supportedTypes) {
+    MediaConfig& config = mutableMedia();
+    for (const auto& type : config.supportedTypes) {
         MediaProperties props{};
         switch (type) {
             case MediaType::TEXT:
@@ -50,16 +70,17 @@ void AIModel::initializeMediaProperties() {
                 props.visual.frameRate = 30;
                 break;
         }
-        mediaProps[type] = props;
+        // Keep properties that were already configured for this type
+        config.mediaProps.emplace(type, props);
     }
 }
 
 bool AIModel::supportsMediaType(MediaType type) const {
-    return supportedTypes.find(type) != supportedTypes.end();
+    return media->supportedTypes.find(type) != media->supportedTypes.end();
 }
 
 std::vector<MediaType> AIModel::getSupportedTypes() const {
-    return std::vector<MediaType>(supportedTypes.begin(), supportedTypes.end());
+    return std::vector<MediaType>(media->supportedTypes.begin(), media->supportedTypes.end());
 }
 
 void AIModel::validateMediaType(MediaType type) const {
@@ -69,149 +90,527 @@ void AIModel::validateMediaType(MediaType type) const {
 }
 
 void AIModel::train() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::array<MediaType, 4> types;
+    size_t count = 0;
+    for (const auto& type : media->supportedTypes) {
+        types[count++] = type;
+    }
+    trainSections(std::span<const MediaType>(types.data(), count));
+}
+
+void AIModel::trainSections(std::span<const MediaType> types, uint64_t dataDigest,
+                            double learningRate) {
+    std::mt19937_64 gen(seed + version);
     std::uniform_real_distribution<> dis(0.0, 0.1);
 
-    accuracy += dis(gen);
+    // The default learning rate reproduces the original accuracy step
+    accuracy += dis(gen) * std::clamp(learningRate / DEFAULT_LEARNING_RATE, 0.0, 10.0);
     if (accuracy > 1.0) accuracy = 1.0;
 
-    // Calculate total weight size for all supported media types
+    // Each media type owns an independently allocated section, so training
+    // one type never allocates or touches the weights of the others
     size_t totalWeightSize = 0;
-    for (const auto& type : supportedTypes) {
-        const auto& props = mediaProps[type];
+    for (const auto& type : types) {
+        size_t sectionSize = layoutSize(type);
+        totalWeightSize += sectionSize;
         switch (type) {
             case MediaType::TEXT:
-                totalWeightSize += props.text.vocabularySize * props.outputSize;
                 std::cout << "Added text weights: " << totalWeightSize << " bytes\n";
                 break;
             case MediaType::IMAGE:
-                totalWeightSize += props.visual.width * props.visual.height * 
-                                 props.visual.channels * props.outputSize;
                 std::cout << "Added image weights: " << totalWeightSize << " bytes\n";
                 break;
             case MediaType::AUDIO:
-                totalWeightSize += props.audio.sampleRate * props.audio.channels * 
-                                 props.outputSize;
                 std::cout << "Added audio weights: " << totalWeightSize << " bytes\n";
                 break;
             case MediaType::VIDEO:
-                totalWeightSize += props.visual.width * props.visual.height * 
-                                 props.visual.channels * props.visual.frameRate * 
-                                 props.outputSize;
                 std::cout << "Added video weights: " << totalWeightSize << " bytes\n";
                 break;
         }
-    }
-
-    std::cout << "Total weight size for all media types: " << totalWeightSize << " bytes\n";
-    weights.resize(totalWeightSize);
 
-    // Initialize weights with random values
-    for (auto& w : weights) {
-        w = static_cast<uint8_t>(dis(gen) * 255);
+        // Initialize weights with random values in [0, 25], the range the
+        // former uniform(0, 0.1) * 255 produced. Each (version, type) pair
+        // draws from its own Philox stream, so a seed fully determines them;
+        // minibatches mix their data digest into the stream.
+        generateSection(type, WeightRecipe{seed, weightStream(version, type) ^ dataDigest,
+                                           sectionSize, 25});
     }
 
+    std::cout << "Total weight size for trained media types: " << totalWeightSize << " bytes\n";
+
     saveWeightSnapshot();
     incrementVersion();
     std::cout << "Model version incremented to: " << version << std::endl;
 }
 
-void AIModel::trainWithText(const std::string& text) {
+size_t AIModel::sectionIndex(MediaType type) {
+    return static_cast<size_t>(std::countr_zero(static_cast<unsigned int>(type)));
+}
+
+size_t AIModel::layoutSize(MediaType type) {
+    size_t& size = sectionLayout[sectionIndex(type)];
+    if (size == 0) {
+        size = weightSectionSize(type);
+    }
+    return size;
+}
+
+void AIModel::generateSection(MediaType type, const WeightRecipe& recipe) {
+    // Same-sized heap storage is reused as is; only a new layout, a section
+    // still mapped from a model file or one shared with a copy of this model
+    // needs fresh storage
+    WeightBuffer* section;
+    {
+        std::lock_guard<std::mutex> lock(sectionGuard.mutex);
+        section = &weightSections[type];
+    }
+    section->reset(recipe.size);
+    kernels::fillRandom(section->mutableData(), recipe.size, recipe.seed, recipe.stream,
+                        recipe.maxValue, computeThreads);
+    currentRecipes[sectionIndex(type)] = recipe;
+}
+
+void AIModel::resetTrainingState() {
+    currentRecipes = {};
+    snapshots.reset();
+    snapshotCount = 0;
+    sectionLayout = {};
+}
+
+size_t AIModel::weightSectionSize(MediaType type) const {
+    const auto& props = media->mediaProps.at(type);
+    switch (type) {
+        // Widened first: the default video section alone exceeds 32 bits
+        case MediaType::TEXT:
+            return size_t(props.text.vocabularySize) * props.outputSize;
+        case MediaType::IMAGE:
+            return size_t(props.visual.width) * props.visual.height *
+                   props.visual.channels * props.outputSize;
+        case MediaType::AUDIO:
+            return size_t(props.audio.sampleRate) * props.audio.channels *
+                   props.outputSize;
+        case MediaType::VIDEO:
+            return size_t(props.visual.width) * props.visual.height *
+                   props.visual.channels * props.visual.frameRate *
+                   props.outputSize;
+    }
+    return 0;
+}
+
+void AIModel::trainWithText(std::string_view text) {
     validateMediaType(MediaType::TEXT);
     std::cout << "Training with text of length: " << text.length() << std::endl;
     std::cout << "Sample text content: " << text.substr(0, 50) << "...\n";
-    train();
+    const MediaType types[] = {MediaType::TEXT};
+    trainSections(types);
 }
 
-void AIModel::trainWithImage(const std::vector<uint8_t>& imageData) {
+void AIModel::trainWithImage(std::span<const uint8_t> imageData) {
     validateMediaType(MediaType::IMAGE);
-    const auto& props = mediaProps[MediaType::IMAGE];
+    const auto& props = media->mediaProps.at(MediaType::IMAGE);
     std::cout << "Training with image of size: " << imageData.size() << " bytes\n";
     std::cout << "Image dimensions: " << props.visual.width << "x" << props.visual.height 
               << "x" << props.visual.channels << "\n";
-    train();
+    const MediaType types[] = {MediaType::IMAGE};
+    trainSections(types);
 }
 
-void AIModel::trainWithAudio(const std::vector<uint8_t>& audioData) {
+void AIModel::trainWithAudio(std::span<const uint8_t> audioData) {
     validateMediaType(MediaType::AUDIO);
-    const auto& props = mediaProps[MediaType::AUDIO];
+    const auto& props = media->mediaProps.at(MediaType::AUDIO);
     std::cout << "Training with audio of size: " << audioData.size() << " bytes\n";
     std::cout << "Audio properties: " << props.audio.sampleRate << "Hz, " 
               << props.audio.channels << " channels\n";
-    train();
+    const MediaType types[] = {MediaType::AUDIO};
+    trainSections(types);
 }
 
-void AIModel::trainWithVideo(const std::vector<uint8_t>& videoData) {
+void AIModel::trainWithVideo(std::span<const uint8_t> videoData) {
     validateMediaType(MediaType::VIDEO);
-    const auto& props = mediaProps[MediaType::VIDEO];
+    const auto& props = media->mediaProps.at(MediaType::VIDEO);
     std::cout << "Training with video of size: " << videoData.size() << " bytes\n";
     std::cout << "Video properties: " << props.visual.width << "x" << props.visual.height 
               << "@" << props.visual.frameRate << "fps\n";
-    train();
+    const MediaType types[] = {MediaType::VIDEO};
+    trainSections(types);
 }
 
-std::string AIModel::processText(const std::string& input) const {
+void AIModel::trainBatch(MediaType type, std::span<const std::span<const uint8_t>> samples,
+                         double learningRate) {
+    validateMediaType(type);
+    if (samples.empty()) {
+        return;
+    }
+
+    // Accumulate the batch into one digest; the update itself runs once
+    uint64_t digest = 0;
+    size_t bytes = 0;
+    for (const auto& sample : samples) {
+        digest = utils::checksum64(sample.data(), sample.size(), digest);
+        bytes += sample.size();
+    }
+    std::cout << "Training with batch of " << samples.size() << " samples (" << bytes
+              << " bytes), learning rate " << learningRate << std::endl;
+    trainSections(std::span<const MediaType>(&type, 1), digest, learningRate);
+}
+
+size_t AIModel::streamChunkSize(MediaType type) const {
+    const auto& props = media->mediaProps.at(type);
+    switch (type) {
+        case MediaType::TEXT:
+            return 64 * 1024;
+        case MediaType::IMAGE:
+        case MediaType::VIDEO:
+            return static_cast<size_t>(props.visual.width) * props.visual.height *
+                   props.visual.channels;
+        case MediaType::AUDIO:
+            return static_cast<size_t>(props.audio.sampleRate) * props.audio.channels *
+                   std::max(1u, props.audio.bitDepth / 8);
+    }
+    return 64 * 1024;
+}
+
+StreamTrainingStats AIModel::trainWithStream(MediaType type, MediaReader& reader,
+                                             const StreamTrainingOptions& options) {
+    validateMediaType(type);
+    size_t chunkSize = options.chunkSize ? options.chunkSize : streamChunkSize(type);
+    std::cout << "Streaming training with " << reader.sizeHint() << " bytes in chunks of "
+              << chunkSize << " bytes\n";
+
+    // Two buffers handed back and forth with one long-lived reader thread:
+    // it fills one buffer while the other is consumed
+    std::vector<uint8_t> buffers[2] = {std::vector<uint8_t>(chunkSize), std::vector<uint8_t>(chunkSize)};
+    struct Chunk {
+        int buffer;
+        size_t length;
+    };
+    BoundedQueue<int> emptyBuffers(2);
+    BoundedQueue<Chunk> filledBuffers(2);
+    emptyBuffers.push(0);
+    emptyBuffers.push(1);
+
+    std::exception_ptr readError;
+    std::thread readerThread([&] {
+        try {
+            while (auto buffer = emptyBuffers.pop()) {
+                size_t length = reader.read(buffers[*buffer]);
+                if (!filledBuffers.push(Chunk{*buffer, length}) || length == 0) {
+                    break;
+                }
+            }
+        } catch (...) {
+            readError = std::current_exception();
+        }
+        filledBuffers.close();
+    });
+
+    StreamTrainingStats stats;
+    utils::Checksum64 checksum;
+    while (auto chunk = filledBuffers.pop()) {
+        if (chunk->length == 0) break;
+        checksum.update(buffers[chunk->buffer].data(), chunk->length);
+        stats.bytes += chunk->length;
+        stats.chunks++;
+        emptyBuffers.push(chunk->buffer);
+    }
+    emptyBuffers.close();
+    readerThread.join();
+    if (readError) {
+        std::rethrow_exception(readError);
+    }
+    stats.digest = checksum.digest();
+
+    std::cout << "Streamed " << stats.bytes << " bytes in " << stats.chunks << " chunks\n";
+    // The stream's digest makes the update depend on the data, as in trainBatch
+    trainSections(std::span<const MediaType>(&type, 1), stats.digest);
+    return stats;
+}
+
+namespace {
+    const std::string_view PROCESSED_PREFIX = "Processed: ";
+}
+
+size_t AIModel::processedSize(MediaType type, size_t inputSize) const {
+    validateMediaType(type);
+    if (type == MediaType::TEXT) {
+        const auto& props = media->mediaProps.at(MediaType::TEXT);
+        return PROCESSED_PREFIX.size() +
+               std::min(inputSize, static_cast<size_t>(props.text.maxSequenceLength));
+    }
+    return inputSize;
+}
+
+size_t AIModel::processTextInto(std::string_view input, std::span<char> output) const {
     validateMediaType(MediaType::TEXT);
-    const auto& props = mediaProps.at(MediaType::TEXT);
-    return "Processed: " + input.substr(0, std::min(input.length(), 
-            static_cast<size_t>(props.text.maxSequenceLength)));
+    // Only the text section is made resident
+    getSectionWeights(MediaType::TEXT);
+    return writeProcessed(MediaType::TEXT,
+        std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(input.data()), input.size()),
+        std::span<uint8_t>(reinterpret_cast<uint8_t*>(output.data()), output.size()));
+}
+
+size_t AIModel::passThrough(MediaType type, std::span<const uint8_t> input,
+                            std::span<uint8_t> output) const {
+    validateMediaType(type);
+    getSectionWeights(type);
+    return writeProcessed(type, input, output);
+}
+
+size_t AIModel::writeProcessed(MediaType type, std::span<const uint8_t> input,
+                               std::span<uint8_t> output) const {
+    if (type == MediaType::TEXT) {
+        const auto& props = media->mediaProps.at(MediaType::TEXT);
+        size_t kept = std::min(input.size(), static_cast<size_t>(props.text.maxSequenceLength));
+        size_t written = PROCESSED_PREFIX.size() + kept;
+        if (output.size() < written) {
+            throw std::runtime_error("Output buffer too small for processed text");
+        }
+        std::copy(PROCESSED_PREFIX.begin(), PROCESSED_PREFIX.end(), output.begin());
+        std::copy(input.begin(), input.begin() + kept, output.begin() + PROCESSED_PREFIX.size());
+        return written;
+    }
+
+    if (output.size() < input.size()) {
+        throw std::runtime_error("Output buffer too small for processed media");
+    }
+    // Nothing to do when processing in place
+    if (output.data() != input.data()) {
+        std::copy(input.begin(), input.end(), output.begin());
+    }
+    return input.size();
+}
+
+size_t AIModel::batchOutputSize(MediaType type, std::span<const std::span<const uint8_t>> inputs) const {
+    size_t total = 0;
+    for (const auto& input : inputs) {
+        total += processedSize(type, input.size());
+    }
+    return total;
+}
+
+void AIModel::processBatch(MediaType type, std::span<const std::span<const uint8_t>> inputs,
+                           std::span<uint8_t> output, std::span<size_t> outputLengths) const {
+    // Validation and section lookup happen once for the whole batch
+    validateMediaType(type);
+    getSectionWeights(type);
+    if (outputLengths.size() < inputs.size()) {
+        throw std::runtime_error("Output length array too small for batch");
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        size_t written = writeProcessed(type, inputs[i], output.subspan(offset));
+        outputLengths[i] = written;
+        offset += written;
+    }
+}
+
+size_t AIModel::processImageInto(std::span<const uint8_t> input, std::span<uint8_t> output) const {
+    return passThrough(MediaType::IMAGE, input, output);
+}
+
+size_t AIModel::processAudioInto(std::span<const uint8_t> input, std::span<uint8_t> output) const {
+    return passThrough(MediaType::AUDIO, input, output);
+}
+
+size_t AIModel::processVideoInto(std::span<const uint8_t> input, std::span<uint8_t> output) const {
+    return passThrough(MediaType::VIDEO, input, output);
+}
+
+size_t AIModel::processInto(MediaType type, std::span<const uint8_t> input,
+                            std::span<uint8_t> output) const {
+    switch (type) {
+        case MediaType::TEXT:
+            return processTextInto(
+                std::string_view(reinterpret_cast<const char*>(input.data()), input.size()),
+                std::span<char>(reinterpret_cast<char*>(output.data()), output.size()));
+        case MediaType::IMAGE:
+            return processImageInto(input, output);
+        case MediaType::AUDIO:
+            return processAudioInto(input, output);
+        case MediaType::VIDEO:
+            return processVideoInto(input, output);
+    }
+    throw std::runtime_error("Model does not support this media type");
+}
+
+std::string AIModel::processText(const std::string& input) const {
+    std::string output(processedSize(MediaType::TEXT, input.size()), '\0');
+    output.resize(processTextInto(input, output));
+    return output;
 }
 
 std::vector<uint8_t> AIModel::processImage(const std::vector<uint8_t>& input) const {
-    validateMediaType(MediaType::IMAGE);
-    return input;
+    std::vector<uint8_t> output(input.size());
+    processImageInto(input, output);
+    return output;
 }
 
 std::vector<uint8_t> AIModel::processAudio(const std::vector<uint8_t>& input) const {
-    validateMediaType(MediaType::AUDIO);
-    return input;
+    std::vector<uint8_t> output(input.size());
+    processAudioInto(input, output);
+    return output;
 }
 
 std::vector<uint8_t> AIModel::processVideo(const std::vector<uint8_t>& input) const {
-    validateMediaType(MediaType::VIDEO);
-    return input;
+    std::vector<uint8_t> output(input.size());
+    processVideoInto(input, output);
+    return output;
 }
 
 void AIModel::configureMediaProperties(MediaType type, const MediaProperties& props) {
     validateMediaType(type);
-    mediaProps[type] = props;
+    mutableMedia().mediaProps[type] = props;
+    // The next training step sizes the section for the new layout
+    sectionLayout[sectionIndex(type)] = 0;
+}
+
+size_t AIModel::sectionWeightBytes(MediaType type) const {
+    validateMediaType(type);
+    return weightSectionSize(type);
+}
+
+const WeightBuffer& AIModel::getSectionWeights(MediaType type) const {
+    validateMediaType(type);
+    // Concurrent readers may both miss; the lock makes one of them load
+    std::lock_guard<std::mutex> lock(sectionGuard.mutex);
+    auto it = weightSections.find(type);
+    if (it != weightSections.end()) {
+        return it->second;
+    }
+    if (weightSource && weightSource->hasSection(type)) {
+        auto loaded = weightSections.emplace(type, weightSource->loadSection(type, verifySections));
+        return loaded.first->second;
+    }
+
+    static const WeightBuffer noWeights;
+    return noWeights;
+}
+
+bool AIModel::isSectionResident(MediaType type) const {
+    std::lock_guard<std::mutex> lock(sectionGuard.mutex);
+    return weightSections.find(type) != weightSections.end();
+}
+
+bool AIModel::releaseSection(MediaType type) {
+    // Only sections backed by a model file can be dropped; they reload on demand
+    if (!weightSource || !weightSource->hasSection(type)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(sectionGuard.mutex);
+    return weightSections.erase(type) > 0;
+}
+
+size_t AIModel::residentWeightBytes() const {
+    std::lock_guard<std::mutex> lock(sectionGuard.mutex);
+    size_t total = 0;
+    for (const auto& [type, section] : weightSections) {
+        total += section.size();
+    }
+    return total;
+}
+
+size_t AIModel::weightBytes() const {
+    std::lock_guard<std::mutex> lock(sectionGuard.mutex);
+    size_t total = 0;
+    for (const auto& [type, section] : weightSections) {
+        total += section.size();
+    }
+    if (weightSource) {
+        for (const auto& type : weightSource->getSectionTypes()) {
+            if (weightSections.find(type) == weightSections.end()) {
+                total += weightSource->getSection(type).rawSize;
+            }
+        }
+    }
+    return total;
+}
+
+void AIModel::setWeightEncoding(MediaType type, WeightEncoding encoding) {
+    validateMediaType(type);
+    mutableMedia().sectionEncodings[type] = encoding;
+}
+
+WeightEncoding AIModel::getWeightEncoding(MediaType type) const {
+    auto it = media->sectionEncodings.find(type);
+    return it != media->sectionEncodings.end() ? it->second : WeightEncoding::RAW;
 }
 
 const MediaProperties& AIModel::getMediaProperties(MediaType type) const {
     validateMediaType(type);
-    return mediaProps.at(type);
+    return media->mediaProps.at(type);
+}
+
+uint64_t AIModel::weightStream(unsigned int version, MediaType type) {
+    return (static_cast<uint64_t>(version) << 8) | static_cast<uint64_t>(type);
+}
+
+std::string AIModel::modelPath(const std::string& modelId, unsigned int version) {
+    return "models/" + modelId + "_v" + std::to_string(version) + ".model";
 }
 
 void AIModel::save() const {
-    std::ofstream file("models/" + id + "_v" + std::to_string(version) + ".model", 
-                      std::ios::binary);
-    if (!file) {
-        throw std::runtime_error("Failed to save model file");
+    modelformat::ModelFileInfo info;
+    info.id = id;
+    info.version = version;
+    info.accuracy = accuracy;
+    info.mediaTypes = getSupportedTypes();
+
+    // One section per trained media type; untrained types are left out
+    std::vector<modelformat::SectionSource> sections;
+    for (const auto& type : media->supportedTypes) {
+        const WeightBuffer& section = getSectionWeights(type);
+        if (!section.empty()) {
+            sections.push_back({type, section.data(), section.size(), getWeightEncoding(type)});
+        }
     }
-    file.write(reinterpret_cast<const char*>(weights.data()), weights.size());
+
+    modelformat::writeModelFile(modelPath(id, version), info, sections);
+}
+
+void AIModel::load(const std::string& modelId, unsigned int fileVersion,
+                   const WeightLoadOptions& options) {
+    version = fileVersion;
+    load(modelId, options);
 }
 
-void AIModel::load(const std::string& modelId) {
-    std::ifstream file("models/" + modelId + "_v" + std::to_string(version) + ".model", 
-                      std::ios::binary);
-    if (!file) {
-        throw std::runtime_error("Failed to load model file");
+void AIModel::load(const std::string& modelId, const WeightLoadOptions& options) {
+    std::shared_ptr<modelformat::ModelFileReader> reader;
+    try {
+        reader = modelformat::ModelFileReader::open(modelPath(modelId, version), options);
+    } catch (const std::exception& e) {
+        throw std::runtime_error(std::string("Failed to load model file: ") + e.what());
     }
 
-    size_t totalSize = 0;
-    for (const auto& [type, props] : mediaProps) {
-        totalSize += props.inputSize * props.outputSize;
+    const auto& info = reader->getInfo();
+    id = info.id;
+    version = info.version;
+    accuracy = info.accuracy;
+    MediaConfig& config = mutableMedia();
+    config.supportedTypes = std::set<MediaType>(info.mediaTypes.begin(), info.mediaTypes.end());
+    config.sectionEncodings.clear();
+    for (const auto& type : reader->getSectionTypes()) {
+        config.sectionEncodings[type] = static_cast<WeightEncoding>(reader->getSection(type).encoding);
     }
+    initializeMediaProperties();
+    validated = false;
 
-    weights.resize(totalSize);
-    file.read(reinterpret_cast<char*>(weights.data()), weights.size());
+    // Sections are loaded on first use, so only the media types actually
+    // used become resident
+    {
+        std::lock_guard<std::mutex> lock(sectionGuard.mutex);
+        weightSections.clear();
+    }
+    resetTrainingState();
+    weightSource = reader;
+    verifySections = options.verifyChecksums;
 }
 
 bool AIModel::validate() {
     validated = true;
-    for (const auto& w : weights) {
-        if (w == 0) {
+    for (const auto& type : media->supportedTypes) {
+        const WeightBuffer& section = getSectionWeights(type);
+        if (!kernels::allNonZero(section.data(), section.size(), computeThreads)) {
             validated = false;
             break;
         }
@@ -220,13 +619,46 @@ bool AIModel::validate() {
 }
 
 void AIModel::saveWeightSnapshot() {
-    weightHistory[version] = weights;
+    if (!snapshots) {
+        snapshots = std::make_shared<SnapshotRing>();
+    } else if (snapshots.use_count() != 1) {
+        snapshots = std::make_shared<SnapshotRing>(*snapshots);
+    } else {
+        // Last owner: other copies' reads of the ring happen before this write
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    WeightSnapshot& slot = (*snapshots)[snapshotCount % SNAPSHOT_DEPTH];
+    slot.version = version;
+    slot.recipes = currentRecipes;
+    snapshotCount++;
+}
+
+std::vector<uint8_t> AIModel::getWeightSnapshot(unsigned int snapshotVersion, MediaType type) const {
+    validateMediaType(type);
+    size_t held = std::min(snapshotCount, SNAPSHOT_DEPTH);
+    for (size_t i = 0; i < held; ++i) {
+        const WeightSnapshot& snapshot = (*snapshots)[(snapshotCount - 1 - i) % SNAPSHOT_DEPTH];
+        if (snapshot.version != snapshotVersion) continue;
+
+        const WeightRecipe& recipe = snapshot.recipes[sectionIndex(type)];
+        std::vector<uint8_t> weights(recipe.size);
+        kernels::fillRandom(weights.data(), recipe.size, recipe.seed, recipe.stream,
+                            recipe.maxValue, computeThreads);
+        return weights;
+    }
+    return {};
+}
+
+std::shared_ptr<AIModel> AIModel::clone() const {
+    // Holding the guard keeps lazy loads from changing the sections mid-copy
+    std::lock_guard<std::mutex> lock(sectionGuard.mutex);
+    return std::make_shared<AIModel>(*this);
 }
 
 std::string AIModel::exportModel() const {
     std::stringstream ss;
     ss << id << "," << name << ",";
-    for (const auto& type : supportedTypes) {
+    for (const auto& type : media->supportedTypes) {
         ss << static_cast<int>(type) << ";";
     }
     ss << accuracy << "," << version;
@@ -237,18 +669,12 @@ bool AIModel::importModel(const std::string& modelData) {
     try {
         if (modelData.empty()) return false;
 
-        size_t totalSize = 0;
-        for (const auto& [type, props] : mediaProps) {
-            totalSize += props.inputSize * props.outputSize;
-        }
-
-        weights.resize(totalSize);
         std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<> dis(0, 255);
+        uint64_t importSeed = (static_cast<uint64_t>(rd()) << 32) | rd();
 
-        for (auto& w : weights) {
-            w = static_cast<uint8_t>(dis(gen));
+        for (const auto& type : media->supportedTypes) {
+            generateSection(type, WeightRecipe{importSeed, weightStream(version, type),
+                                               layoutSize(type), 254});
         }
 
         return true;
@@ -262,7 +688,11 @@ std::string AIModel::generateId() {
     auto duration = now.time_since_epoch();
     auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
 
+    // Models created within the same millisecond get distinct suffixes; the
+    // sequence starts at a random point so separate processes rarely collide
+    static std::atomic<uint32_t> sequence{std::random_device{}()};
+
     std::stringstream ss;
-    ss << std::hex << millis;
+    ss << std::hex << millis << std::setw(4) << std::setfill('0') << (sequence++ & 0xFFFF);
     return ss.str();
 }
\ No newline at end of file
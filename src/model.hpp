@@ -2,10 +2,17 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <cstdint>
 #include <map>
 #include <set>
+#include <array>
 #include <sstream>
+#include <span>
+#include <string_view>
+#include "weights.hpp"
+#include "weight_codec.hpp"
+#include "media_reader.hpp"
 
 enum class MediaType {
     TEXT = 1,
@@ -39,8 +46,46 @@ struct MediaProperties {
     };
 };
 
+struct StreamTrainingOptions {
+    // Bytes per chunk; 0 uses one natural unit of the media type
+    // (a video frame, one second of audio, one image)
+    size_t chunkSize = 0;
+};
+
+struct StreamTrainingStats {
+    uint64_t bytes = 0;
+    uint64_t chunks = 0;
+    uint64_t digest = 0;        // checksum over the whole stream
+};
+
+// How a section's weights were generated; replaying it reproduces them exactly
+struct WeightRecipe {
+    uint64_t seed = 0;
+    uint64_t stream = 0;
+    size_t size = 0;            // 0 when the weights did not come from a recipe
+    uint8_t maxValue = 0;
+};
+
+// Controls how model files are brought into memory by AIModel::load
+struct WeightLoadOptions {
+    bool useMmap = true;        // map the file instead of reading it into the heap
+    MapAdvice advice = MapAdvice::WILLNEED;
+    bool hugePages = false;
+    bool verifyChecksums = false;   // checksum each section as it is loaded
+};
+
+namespace modelformat {
+    class ModelFileReader;
+}
+
+// Copying a model is cheap: weight bytes, media configuration and the
+// snapshot ring are shared between the copies until one of them changes
+// its own. Const methods may be called from several threads at once;
+// anything else needs exclusive access.
 class AIModel {
 public:
+    static constexpr double DEFAULT_LEARNING_RATE = 0.01;
+
     AIModel(const std::string& name, const std::vector<MediaType>& supportedTypes);
 
     std::string getId() const { return id; }
@@ -48,15 +93,35 @@ public:
     double getAccuracy() const { return accuracy; }
     unsigned int getVersion() const { return version; }
     bool isValidated() const { return validated; }
+
+    // Seed of the weight generator; equal seeds give identical weights
+    uint64_t getSeed() const { return seed; }
+    void setSeed(uint64_t newSeed) { seed = newSeed; }
+
+    // Threads used by the weight kernels; 0 uses one per core
+    unsigned int getComputeThreads() const { return computeThreads; }
+    void setComputeThreads(unsigned int threads) { computeThreads = threads; }
     bool supportsMediaType(MediaType type) const;
     std::vector<MediaType> getSupportedTypes() const;
 
     // Enhanced training methods
     void train();
-    void trainWithText(const std::string& text);
-    void trainWithImage(const std::vector<uint8_t>& imageData);
-    void trainWithAudio(const std::vector<uint8_t>& audioData);
-    void trainWithVideo(const std::vector<uint8_t>& videoData);
+    void trainWithText(std::string_view text);
+    void trainWithImage(std::span<const uint8_t> imageData);
+    void trainWithAudio(std::span<const uint8_t> audioData);
+    void trainWithVideo(std::span<const uint8_t> videoData);
+
+    // Minibatch training: the samples of one batch are folded into a single
+    // weight update, so a batch costs one update however many samples it
+    // holds. learningRate scales the accuracy gained by the update.
+    void trainBatch(MediaType type, std::span<const std::span<const uint8_t>> samples,
+                    double learningRate = DEFAULT_LEARNING_RATE);
+
+    // Streaming training: consumes the reader chunk by chunk with the next
+    // read overlapping the current chunk, so memory stays at two chunks
+    // regardless of input size
+    StreamTrainingStats trainWithStream(MediaType type, MediaReader& reader,
+                                        const StreamTrainingOptions& options = StreamTrainingOptions());
 
     // Media processing methods
     std::string processText(const std::string& input) const;
@@ -64,9 +129,53 @@ public:
     std::vector<uint8_t> processAudio(const std::vector<uint8_t>& input) const;
     std::vector<uint8_t> processVideo(const std::vector<uint8_t>& input) const;
 
+    // Zero-copy processing: results are written into a caller-provided buffer
+    // of at least processedSize() bytes and the number of bytes written is
+    // returned. None of these allocate.
+    size_t processedSize(MediaType type, size_t inputSize) const;
+    size_t processTextInto(std::string_view input, std::span<char> output) const;
+    size_t processImageInto(std::span<const uint8_t> input, std::span<uint8_t> output) const;
+    size_t processAudioInto(std::span<const uint8_t> input, std::span<uint8_t> output) const;
+    size_t processVideoInto(std::span<const uint8_t> input, std::span<uint8_t> output) const;
+    size_t processInto(MediaType type, std::span<const uint8_t> input, std::span<uint8_t> output) const;
+
+    // Batch processing of inputs of one media type: the type is validated and
+    // its weights resolved once, then results are written back to back into
+    // output, which must hold batchOutputSize() bytes. outputLengths[i]
+    // receives the length of result i.
+    size_t batchOutputSize(MediaType type, std::span<const std::span<const uint8_t>> inputs) const;
+    void processBatch(MediaType type, std::span<const std::span<const uint8_t>> inputs,
+                      std::span<uint8_t> output, std::span<size_t> outputLengths) const;
+
+    // Copy that may be taken while other threads are processing with this model
+    std::shared_ptr<AIModel> clone() const;
+
     void save() const;
-    void load(const std::string& modelId);
+    void load(const std::string& modelId, const WeightLoadOptions& options = WeightLoadOptions());
+    // Loads a specific saved version instead of this model's current one
+    void load(const std::string& modelId, unsigned int fileVersion,
+              const WeightLoadOptions& options = WeightLoadOptions());
     bool validate();
+
+    // Per-media-type weights. Sections of a loaded model file become resident
+    // on first access; releaseSection() drops a file-backed section again.
+    const WeightBuffer& getSectionWeights(MediaType type) const;
+    bool isSectionResident(MediaType type) const;
+    bool releaseSection(MediaType type);
+    size_t residentWeightBytes() const;
+    // Bytes a trained section of type takes under the current media properties
+    size_t sectionWeightBytes(MediaType type) const;
+    // Bytes the weights occupy once every section is resident
+    size_t weightBytes() const;
+
+    // Regenerates the weights a section had after the training step at
+    // version. Empty if that step has left the snapshot ring or the section
+    // was loaded from a file rather than generated.
+    std::vector<uint8_t> getWeightSnapshot(unsigned int version, MediaType type) const;
+
+    // Encoding used for a section when the model is saved (RAW by default)
+    void setWeightEncoding(MediaType type, WeightEncoding encoding);
+    WeightEncoding getWeightEncoding(MediaType type) const;
     void incrementVersion() { version++; }
 
     // Model sharing functionality
@@ -81,7 +190,7 @@ public:
     std::string getDebugInfo() const {
         std::stringstream ss;
         ss << "Supported Types: ";
-        for (const auto& type : supportedTypes) {
+        for (const auto& type : media->supportedTypes) {
             switch(type) {
                 case MediaType::TEXT: ss << "TEXT "; break;
                 case MediaType::IMAGE: ss << "IMAGE "; break;
@@ -89,24 +198,75 @@ public:
                 case MediaType::VIDEO: ss << "VIDEO "; break;
             }
         }
-        ss << "| Weight Size: " << weights.size() << " bytes"
+        ss << "| Weight Size: " << residentWeightBytes() << " bytes"
            << " | Validated: " << (validated ? "Yes" : "No");
         return ss.str();
     }
 
 private:
+    // Media configuration rarely changes after construction, so copies of a
+    // model share one immutable instance and a change replaces it
+    struct MediaConfig {
+        std::set<MediaType> supportedTypes;
+        std::map<MediaType, MediaProperties> mediaProps;
+        std::map<MediaType, WeightEncoding> sectionEncodings;
+    };
+
     std::string id;
     std::string name;
-    std::set<MediaType> supportedTypes;
+    std::shared_ptr<const MediaConfig> media;
     double accuracy;
-    std::vector<std::uint8_t> weights;
     unsigned int version;
     bool validated;
-    std::map<unsigned int, std::vector<std::uint8_t>> weightHistory;
-    std::map<MediaType, MediaProperties> mediaProps;
+    uint64_t seed;
+    unsigned int computeThreads = 0;
+    // Copying a model shares the weight bytes; a copy that trains or
+    // reconfigures a section writes to private storage (see WeightBuffer)
+    mutable std::map<MediaType, WeightBuffer> weightSections;
+    // Guards weightSections against concurrent lazy loads; a copy gets its own
+    struct SectionGuard {
+        SectionGuard() = default;
+        SectionGuard(const SectionGuard&) {}
+        SectionGuard& operator=(const SectionGuard&) { return *this; }
+        std::mutex mutex;
+    };
+    mutable SectionGuard sectionGuard;
+    std::shared_ptr<const modelformat::ModelFileReader> weightSource;
+    bool verifySections = false;
+
+    // Training state. Sections keep their storage between training steps and
+    // are regenerated in place; a section is only resized when
+    // configureMediaProperties changes its layout. Snapshots record recipes
+    // in a fixed ring instead of copying the weights, so a training step
+    // allocates nothing once the sections exist. The ring is shared between
+    // copies until one of them trains.
+    static constexpr size_t SNAPSHOT_DEPTH = 64;
+    struct WeightSnapshot {
+        unsigned int version = 0;
+        std::array<WeightRecipe, 4> recipes;    // indexed by sectionIndex()
+    };
+    using SnapshotRing = std::array<WeightSnapshot, SNAPSHOT_DEPTH>;
+    std::array<WeightRecipe, 4> currentRecipes;
+    std::shared_ptr<SnapshotRing> snapshots;
+    size_t snapshotCount = 0;
+    std::array<size_t, 4> sectionLayout{};      // 0 until computed
 
     static std::string generateId();
+    static uint64_t weightStream(unsigned int version, MediaType type);
+    static std::string modelPath(const std::string& modelId, unsigned int version);
+    static size_t sectionIndex(MediaType type);
+    // Private copy of the media configuration for a change
+    MediaConfig& mutableMedia();
+    size_t weightSectionSize(MediaType type) const;
+    size_t layoutSize(MediaType type);
+    size_t streamChunkSize(MediaType type) const;
+    void generateSection(MediaType type, const WeightRecipe& recipe);
+    void trainSections(std::span<const MediaType> types, uint64_t dataDigest = 0,
+                       double learningRate = DEFAULT_LEARNING_RATE);
+    void resetTrainingState();
     void saveWeightSnapshot();
     void initializeMediaProperties();
     void validateMediaType(MediaType type) const;
+    size_t passThrough(MediaType type, std::span<const uint8_t> input, std::span<uint8_t> output) const;
+    size_t writeProcessed(MediaType type, std::span<const uint8_t> input, std::span<uint8_t> output) const;
 };
\ No newline at end of file
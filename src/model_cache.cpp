@@ -0,0 +1,201 @@
+#include "model_cache.hpp"
+#include <stdexcept>
+#include <thread>
+
+ModelCache::Pin::Pin(ModelCache* cache, std::string id, ModelHandle model)
+    : cache(cache), id(std::move(id)), model(std::move(model)) {}
+
+ModelCache::Pin::Pin(Pin&& other) noexcept
+    : cache(other.cache), id(std::move(other.id)), model(std::move(other.model)) {
+    other.cache = nullptr;
+}
+
+ModelCache::Pin& ModelCache::Pin::operator=(Pin&& other) noexcept {
+    if (this != &other) {
+        release();
+        cache = other.cache;
+        id = std::move(other.id);
+        model = std::move(other.model);
+        other.cache = nullptr;
+    }
+    return *this;
+}
+
+ModelCache::Pin::~Pin() {
+    release();
+}
+
+void ModelCache::Pin::release() {
+    if (cache) {
+        cache->unpin(id);
+        cache = nullptr;
+    }
+    model.reset();
+}
+
+ModelCache::ModelCache(ModelStorage& storage, std::size_t byteBudget,
+                       Loader loader, const WeightLoadOptions& options)
+    : storage(storage), loader(std::move(loader)), loadOptions(options), budget(byteBudget) {
+    if (!this->loader) {
+        this->loader = [this](const std::string& id) { return loadFromStorage(id); };
+    }
+}
+
+ModelCache::~ModelCache() {
+    // Loads run on detached threads that still reference the cache
+    std::unique_lock<std::mutex> lock(mutex);
+    loadsDone.wait(lock, [this] { return loadsInFlight == 0; });
+}
+
+ModelHandle ModelCache::loadFromStorage(const std::string& id) const {
+    if (ModelHandle resident = storage.getModel(id)) {
+        return resident;
+    }
+    auto record = storage.getRecord(id);
+    if (!record) {
+        throw std::runtime_error("Unknown model: " + id);
+    }
+    std::vector<MediaType> types;
+    for (MediaType type : {MediaType::TEXT, MediaType::IMAGE, MediaType::AUDIO, MediaType::VIDEO}) {
+        if (record->supports(type)) {
+            types.push_back(type);
+        }
+    }
+    auto model = std::make_shared<AIModel>(record->name, types);
+    model->load(id, record->version, loadOptions);
+    return model;
+}
+
+std::shared_future<ModelHandle> ModelCache::lookup(const std::string& id, bool pinned) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = entries.find(id);
+    if (it != entries.end()) {
+        // A load already in flight counts as a hit: the miss was paid once
+        stats.hits++;
+        lru.splice(lru.begin(), lru, it->second.position);
+        if (pinned) {
+            it->second.pins++;
+        }
+        return it->second.model;
+    }
+
+    stats.misses++;
+    std::promise<ModelHandle> promise;
+    Entry entry;
+    entry.model = promise.get_future().share();
+    entry.pins = pinned ? 1 : 0;
+    lru.push_front(id);
+    entry.position = lru.begin();
+    auto future = entry.model;
+    entries.emplace(id, std::move(entry));
+    loadsInFlight++;
+    lock.unlock();
+
+    try {
+        std::thread(&ModelCache::loadEntry, this, id, std::move(promise)).detach();
+    } catch (...) {
+        // Could not start a thread: load on the caller instead
+        loadEntry(id, std::move(promise));
+    }
+    return future;
+}
+
+void ModelCache::loadEntry(std::string id, std::promise<ModelHandle> promise) {
+    ModelHandle model;
+    std::exception_ptr error;
+    try {
+        model = loader(id);
+        if (!model) {
+            throw std::runtime_error("Model loader returned nothing for " + id);
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(id);
+    if (error) {
+        // Forget the entry so the next request retries the load
+        stats.loadFailures++;
+        lru.erase(it->second.position);
+        entries.erase(it);
+        promise.set_exception(error);
+    } else {
+        it->second.bytes = model->weightBytes();
+        it->second.ready = true;
+        stats.residentBytes += it->second.bytes;
+        promise.set_value(std::move(model));
+        evictLocked();
+    }
+    loadsInFlight--;
+    loadsDone.notify_all();
+}
+
+ModelCache::Pin ModelCache::pin(const std::string& id) {
+    // A failed load drops its entry and with it this pin
+    ModelHandle model = lookup(id, true).get();
+    return Pin(this, id, std::move(model));
+}
+
+std::shared_future<ModelHandle> ModelCache::prefetch(const std::string& id) {
+    return lookup(id, false);
+}
+
+void ModelCache::unpin(const std::string& id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(id);
+    if (it != entries.end() && it->second.pins > 0 && --it->second.pins == 0) {
+        evictLocked();
+    }
+}
+
+void ModelCache::evictLocked() {
+    auto it = lru.end();
+    while (stats.residentBytes > budget && it != lru.begin()) {
+        --it;
+        auto entry = entries.find(*it);
+        if (!entry->second.ready || entry->second.pins > 0) {
+            continue;
+        }
+        stats.residentBytes -= entry->second.bytes;
+        stats.evictions++;
+        entries.erase(entry);
+        it = lru.erase(it);
+    }
+}
+
+bool ModelCache::contains(const std::string& id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(id);
+    return it != entries.end() && it->second.ready;
+}
+
+bool ModelCache::invalidate(const std::string& id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(id);
+    if (it == entries.end() || !it->second.ready || it->second.pins > 0) {
+        return false;
+    }
+    stats.residentBytes -= it->second.bytes;
+    lru.erase(it->second.position);
+    entries.erase(it);
+    return true;
+}
+
+void ModelCache::setBudget(std::size_t byteBudget) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = byteBudget;
+    evictLocked();
+}
+
+std::size_t ModelCache::getBudget() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return budget;
+}
+
+ModelCacheStats ModelCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    ModelCacheStats snapshot = stats;
+    snapshot.entries = entries.size();
+    return snapshot;
+}
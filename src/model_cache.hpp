@@ -0,0 +1,106 @@
+#pragma once
+#include "model.hpp"
+#include "storage.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct ModelCacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+    std::uint64_t loadFailures = 0;
+    std::size_t residentBytes = 0;
+    std::size_t entries = 0;
+};
+
+// Byte-bounded LRU cache of loaded models in front of ModelStorage. A miss
+// loads the model on a background thread; concurrent misses for the same id
+// share that load. Pinned models are never evicted, so the budget can be
+// exceeded while everything resident is pinned and is restored as pins are
+// released. Models are charged AIModel::weightBytes(), i.e. their size once
+// every section is resident.
+class ModelCache {
+public:
+    // Produces a loaded model for an id; throws if it cannot
+    using Loader = std::function<ModelHandle(const std::string& id)>;
+
+    // Without a loader, resident models are taken from storage and the rest
+    // are loaded from their saved file at the catalogued version
+    ModelCache(ModelStorage& storage, std::size_t byteBudget,
+               Loader loader = nullptr, const WeightLoadOptions& options = WeightLoadOptions());
+    ~ModelCache();
+
+    ModelCache(const ModelCache&) = delete;
+    ModelCache& operator=(const ModelCache&) = delete;
+
+    // Keeps a cached model resident while it is alive
+    class Pin {
+    public:
+        Pin() = default;
+        Pin(Pin&& other) noexcept;
+        Pin& operator=(Pin&& other) noexcept;
+        ~Pin();
+
+        const AIModel* operator->() const { return model.get(); }
+        const AIModel& operator*() const { return *model; }
+        const ModelHandle& handle() const { return model; }
+        explicit operator bool() const { return model != nullptr; }
+        void release();
+
+    private:
+        friend class ModelCache;
+        Pin(ModelCache* cache, std::string id, ModelHandle model);
+
+        ModelCache* cache = nullptr;
+        std::string id;
+        ModelHandle model;
+    };
+
+    // Returns the model pinned, waiting for its load on a miss. Rethrows the
+    // loader's exception if the load fails.
+    Pin pin(const std::string& id);
+    // Starts loading the model if it is not cached yet
+    std::shared_future<ModelHandle> prefetch(const std::string& id);
+
+    bool contains(const std::string& id) const;
+    // Drops an unpinned entry; false if it is pinned, loading or absent
+    bool invalidate(const std::string& id);
+
+    void setBudget(std::size_t byteBudget);
+    std::size_t getBudget() const;
+    ModelCacheStats getStats() const;
+
+private:
+    struct Entry {
+        std::shared_future<ModelHandle> model;
+        std::size_t bytes = 0;
+        std::size_t pins = 0;
+        bool ready = false;
+        std::list<std::string>::iterator position;  // into lru
+    };
+
+    std::shared_future<ModelHandle> lookup(const std::string& id, bool pinned);
+    void loadEntry(std::string id, std::promise<ModelHandle> promise);
+    void unpin(const std::string& id);
+    void evictLocked();
+    ModelHandle loadFromStorage(const std::string& id) const;
+
+    ModelStorage& storage;
+    Loader loader;
+    WeightLoadOptions loadOptions;
+    std::size_t budget;
+
+    mutable std::mutex mutex;
+    std::condition_variable loadsDone;
+    std::size_t loadsInFlight = 0;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru;     // most recently used first
+    ModelCacheStats stats;
+};
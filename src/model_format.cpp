@@ -0,0 +1,282 @@
+#include "model_format.hpp"
+#include "utils.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <cstddef>
+
+namespace modelformat {
+    namespace {
+        const char MAGIC[8] = {'D', 'A', 'G', 'I', 'M', 'D', 'L', '\0'};
+        const std::uint32_t MAX_SECTIONS = 4;   // one per MediaType
+
+        std::uint64_t alignUp(std::uint64_t value, std::uint64_t alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        bool isMediaType(std::uint32_t value) {
+            switch (static_cast<MediaType>(value)) {
+                case MediaType::TEXT:
+                case MediaType::IMAGE:
+                case MediaType::AUDIO:
+                case MediaType::VIDEO:
+                    return true;
+            }
+            return false;
+        }
+
+        std::uint64_t headerChecksum(const FileHeader& header) {
+            return utils::checksum64(&header, offsetof(FileHeader, headerChecksum));
+        }
+    }
+
+    void writeModelFile(const std::string& path, const ModelFileInfo& info,
+                        const std::vector<SectionSource>& sections,
+                        std::uint32_t alignment) {
+        if (sections.size() > MAX_SECTIONS) {
+            throw std::runtime_error("Too many weight sections for model file");
+        }
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+            throw std::runtime_error("Section alignment must be a power of two");
+        }
+
+        FileHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.formatVersion = FORMAT_VERSION;
+        header.headerSize = sizeof(FileHeader);
+        header.sectionCount = static_cast<std::uint32_t>(sections.size());
+        header.sectionAlignment = alignment;
+        header.modelVersion = info.version;
+        header.accuracy = info.accuracy;
+        for (const auto& type : info.mediaTypes) {
+            header.mediaTypes |= static_cast<std::uint32_t>(type);
+        }
+        std::strncpy(header.modelId, info.id.c_str(), sizeof(header.modelId) - 1);
+
+        // Encoded sections are produced up front; RAW ones are written from the caller's buffer
+        std::vector<std::vector<std::uint8_t>> encoded(sections.size());
+        std::vector<const std::uint8_t*> stored(sections.size());
+        std::vector<SectionEntry> table(sections.size());
+        std::uint64_t cursor = sizeof(FileHeader) + table.size() * sizeof(SectionEntry);
+        for (size_t i = 0; i < sections.size(); ++i) {
+            const SectionSource& source = sections[i];
+            std::size_t storedSize = source.size;
+            stored[i] = source.data;
+            if (source.encoding != WeightEncoding::RAW) {
+                encoded[i] = codecFor(source.encoding).encode(source.data, source.size);
+                stored[i] = encoded[i].data();
+                storedSize = encoded[i].size();
+            }
+
+            SectionEntry& entry = table[i];
+            entry.mediaType = static_cast<std::uint32_t>(source.type);
+            entry.encoding = static_cast<std::uint32_t>(source.encoding);
+            entry.offset = alignUp(cursor, alignment);
+            entry.storedSize = storedSize;
+            entry.rawSize = source.size;
+            entry.alignment = alignment;
+            entry.checksum = utils::checksum64(stored[i], storedSize);
+            cursor = entry.offset + entry.storedSize;
+        }
+        header.fileSize = cursor;
+        header.tableChecksum = utils::checksum64(table.data(), table.size() * sizeof(SectionEntry));
+        header.headerChecksum = headerChecksum(header);
+
+        // Synced and renamed into place like every other atomic save
+        std::vector<std::span<const std::uint8_t>> pieces;
+        pieces.reserve(2 + sections.size() * 2);
+        pieces.emplace_back(reinterpret_cast<const std::uint8_t*>(&header), sizeof(header));
+        pieces.emplace_back(reinterpret_cast<const std::uint8_t*>(table.data()),
+                            table.size() * sizeof(SectionEntry));
+
+        std::uint64_t written = sizeof(FileHeader) + table.size() * sizeof(SectionEntry);
+        const std::vector<std::uint8_t> padding(alignment, 0);
+        for (size_t i = 0; i < sections.size(); ++i) {
+            pieces.emplace_back(padding.data(), table[i].offset - written);
+            pieces.emplace_back(stored[i], table[i].storedSize);
+            written = table[i].offset + table[i].storedSize;
+        }
+        utils::saveBinaryFile(path, pieces, true);
+    }
+
+    bool validateModelFile(const std::string& path, std::string* error) {
+        try {
+            WeightLoadOptions options;
+            options.useMmap = false;
+            ModelFileReader::open(path, options);
+            return true;
+        } catch (const std::exception& e) {
+            if (error) *error = e.what();
+            return false;
+        }
+    }
+
+    std::shared_ptr<ModelFileReader> ModelFileReader::open(const std::string& path,
+                                                           const WeightLoadOptions& options) {
+        std::shared_ptr<ModelFileReader> reader(new ModelFileReader());
+        reader->path = path;
+        reader->options = options;
+
+        if (options.useMmap) {
+            MapOptions mapOptions;
+            mapOptions.advice = options.advice;
+            mapOptions.hugePages = options.hugePages;
+            reader->file = MappedFile::open(path, mapOptions);
+            reader->parse(reader->file->data(), reader->file->size(), reader->file->size());
+            return reader;
+        }
+
+        // Read only the header and section table
+        std::ifstream& file = reader->stream;
+        file.open(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            throw std::runtime_error("Failed to open model file: " + path);
+        }
+        std::uint64_t actualSize = static_cast<std::uint64_t>(file.tellg());
+        file.seekg(0);
+
+        std::vector<std::uint8_t> bytes(sizeof(FileHeader));
+        if (actualSize < bytes.size() ||
+            !file.read(reinterpret_cast<char*>(bytes.data()), bytes.size())) {
+            throw std::runtime_error("Model file too small for header: " + path);
+        }
+        FileHeader header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (header.sectionCount <= MAX_SECTIONS) {
+            bytes.resize(sizeof(FileHeader) + header.sectionCount * sizeof(SectionEntry));
+            file.read(reinterpret_cast<char*>(bytes.data()) + sizeof(FileHeader),
+                      bytes.size() - sizeof(FileHeader));
+            if (!file) {
+                throw std::runtime_error("Model file truncated in section table: " + path);
+            }
+        }
+        reader->parse(bytes.data(), bytes.size(), actualSize);
+        return reader;
+    }
+
+    void ModelFileReader::parse(const std::uint8_t* bytes, std::size_t available,
+                                std::uint64_t actualSize) {
+        if (available < sizeof(FileHeader)) {
+            throw std::runtime_error("Model file too small for header: " + path);
+        }
+        FileHeader header;
+        std::memcpy(&header, bytes, sizeof(header));
+
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+            throw std::runtime_error("Not a model file: " + path);
+        }
+        if (header.formatVersion != FORMAT_VERSION || header.headerSize != sizeof(FileHeader)) {
+            throw std::runtime_error("Unsupported model file version: " + path);
+        }
+        if (header.headerChecksum != headerChecksum(header)) {
+            throw std::runtime_error("Model file header checksum mismatch: " + path);
+        }
+        if (header.fileSize != actualSize) {
+            throw std::runtime_error("Model file size mismatch: " + path);
+        }
+        if (header.sectionCount > MAX_SECTIONS) {
+            throw std::runtime_error("Model file has too many sections: " + path);
+        }
+
+        std::size_t tableBytes = header.sectionCount * sizeof(SectionEntry);
+        if (available < sizeof(FileHeader) + tableBytes) {
+            throw std::runtime_error("Model file truncated in section table: " + path);
+        }
+        const std::uint8_t* tableStart = bytes + sizeof(FileHeader);
+        if (header.tableChecksum != utils::checksum64(tableStart, tableBytes)) {
+            throw std::runtime_error("Model file section table checksum mismatch: " + path);
+        }
+
+        sections.resize(header.sectionCount);
+        std::memcpy(sections.data(), tableStart, tableBytes);
+
+        std::uint32_t seenTypes = 0;
+        std::uint64_t dataStart = sizeof(FileHeader) + tableBytes;
+        for (const auto& entry : sections) {
+            if (!isMediaType(entry.mediaType) || (seenTypes & entry.mediaType)) {
+                throw std::runtime_error("Model file has an invalid section type: " + path);
+            }
+            seenTypes |= entry.mediaType;
+            if (entry.encoding > static_cast<std::uint32_t>(WeightEncoding::RANS) ||
+                (entry.encoding == static_cast<std::uint32_t>(WeightEncoding::RAW) &&
+                 entry.storedSize != entry.rawSize)) {
+                throw std::runtime_error("Model file has an invalid section encoding: " + path);
+            }
+            if (entry.alignment == 0 || entry.offset % entry.alignment != 0 ||
+                entry.offset < dataStart || entry.offset + entry.storedSize > actualSize) {
+                throw std::runtime_error("Model file section out of bounds: " + path);
+            }
+        }
+
+        info.id.assign(header.modelId, strnlen(header.modelId, sizeof(header.modelId)));
+        info.version = header.modelVersion;
+        info.accuracy = header.accuracy;
+        info.mediaTypes.clear();
+        for (MediaType type : {MediaType::TEXT, MediaType::IMAGE, MediaType::AUDIO, MediaType::VIDEO}) {
+            if (header.mediaTypes & static_cast<std::uint32_t>(type)) {
+                info.mediaTypes.push_back(type);
+            }
+        }
+    }
+
+    std::vector<MediaType> ModelFileReader::getSectionTypes() const {
+        std::vector<MediaType> types;
+        for (const auto& entry : sections) {
+            types.push_back(static_cast<MediaType>(entry.mediaType));
+        }
+        return types;
+    }
+
+    bool ModelFileReader::hasSection(MediaType type) const {
+        for (const auto& entry : sections) {
+            if (entry.mediaType == static_cast<std::uint32_t>(type)) return true;
+        }
+        return false;
+    }
+
+    const SectionEntry& ModelFileReader::getSection(MediaType type) const {
+        for (const auto& entry : sections) {
+            if (entry.mediaType == static_cast<std::uint32_t>(type)) return entry;
+        }
+        throw std::runtime_error("Model file has no section for this media type");
+    }
+
+    WeightBuffer ModelFileReader::loadSection(MediaType type, bool verifyChecksum) const {
+        const SectionEntry& entry = getSection(type);
+        WeightEncoding encoding = static_cast<WeightEncoding>(entry.encoding);
+
+        WeightBuffer stored;
+        if (file) {
+            stored = WeightBuffer::fromMapping(file, entry.offset, entry.storedSize);
+        } else {
+            std::vector<std::uint8_t> bytes(entry.storedSize);
+            std::lock_guard<std::mutex> lock(streamMutex);
+            stream.clear();
+            stream.seekg(static_cast<std::streamoff>(entry.offset));
+            if (!stream || !stream.read(reinterpret_cast<char*>(bytes.data()), bytes.size())) {
+                throw std::runtime_error("Failed to read model section: " + path);
+            }
+            stored = WeightBuffer(std::move(bytes));
+        }
+
+        if (verifyChecksum && utils::checksum64(stored.data(), stored.size()) != entry.checksum) {
+            throw std::runtime_error("Model section checksum mismatch: " + path);
+        }
+        if (encoding == WeightEncoding::RAW) {
+            return stored;
+        }
+
+        std::vector<std::uint8_t> raw(entry.rawSize);
+        codecFor(encoding).decode(stored.data(), stored.size(), raw.data(), raw.size());
+        return WeightBuffer(std::move(raw));
+    }
+
+    bool ModelFileReader::verifySection(MediaType type) const {
+        try {
+            loadSection(type, true);
+            return true;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "model.hpp"
+#include "weights.hpp"
+#include "weight_codec.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <cstdint>
+
+// On-disk model container:
+//
+//   FileHeader | SectionEntry[sectionCount] | padding | section 0 | padding | section 1 ...
+//
+// Every section holds the weights of one MediaType and starts on a
+// sectionAlignment boundary, so a section can be mapped or read on its own.
+// The header and section table carry their own checksums, which lets a file
+// be validated without touching any weight data. All fields are stored in
+// host (little-endian) byte order.
+namespace modelformat {
+    constexpr std::uint32_t FORMAT_VERSION = 1;
+    constexpr std::uint32_t DEFAULT_ALIGNMENT = 4096;
+
+    struct FileHeader {
+        char magic[8];                  // "DAGIMDL\0"
+        std::uint32_t formatVersion;
+        std::uint32_t headerSize;
+        std::uint32_t sectionCount;
+        std::uint32_t sectionAlignment;
+        std::uint32_t modelVersion;
+        std::uint32_t mediaTypes;       // bitwise OR of MediaType values
+        double accuracy;
+        std::uint64_t fileSize;
+        std::uint64_t tableChecksum;    // checksum of the section table
+        char modelId[64];
+        std::uint64_t headerChecksum;   // checksum of all preceding header bytes
+    };
+    static_assert(sizeof(FileHeader) == 128, "FileHeader layout must stay fixed");
+
+    struct SectionEntry {
+        std::uint32_t mediaType;
+        std::uint32_t encoding;         // WeightEncoding
+        std::uint64_t offset;
+        std::uint64_t storedSize;       // bytes on disk
+        std::uint64_t rawSize;          // bytes once decoded
+        std::uint32_t alignment;
+        std::uint32_t reserved;
+        std::uint64_t checksum;         // checksum of the stored bytes
+    };
+    static_assert(sizeof(SectionEntry) == 48, "SectionEntry layout must stay fixed");
+
+    struct ModelFileInfo {
+        std::string id;
+        unsigned int version = 0;
+        double accuracy = 0.0;
+        std::vector<MediaType> mediaTypes;
+    };
+
+    struct SectionSource {
+        MediaType type;
+        const std::uint8_t* data;
+        std::size_t size;
+        WeightEncoding encoding = WeightEncoding::RAW;
+    };
+
+    // Writes a complete model file atomically (temporary file + rename)
+    void writeModelFile(const std::string& path, const ModelFileInfo& info,
+                        const std::vector<SectionSource>& sections,
+                        std::uint32_t alignment = DEFAULT_ALIGNMENT);
+
+    // Checks header, section table and section bounds without reading weights
+    bool validateModelFile(const std::string& path, std::string* error = nullptr);
+
+    class ModelFileReader {
+    public:
+        static std::shared_ptr<ModelFileReader> open(const std::string& path,
+                                                     const WeightLoadOptions& options = WeightLoadOptions());
+
+        const ModelFileInfo& getInfo() const { return info; }
+        const std::string& getPath() const { return path; }
+        std::vector<MediaType> getSectionTypes() const;
+        bool hasSection(MediaType type) const;
+        const SectionEntry& getSection(MediaType type) const;
+
+        // Loads the weights of a single media type; only that section is read.
+        // RAW sections stay mapped, encoded ones are decoded onto the heap.
+        WeightBuffer loadSection(MediaType type, bool verifyChecksum = true) const;
+        bool verifySection(MediaType type) const;
+
+    private:
+        ModelFileReader() = default;
+        void parse(const std::uint8_t* bytes, std::size_t available, std::uint64_t actualSize);
+
+        std::string path;
+        WeightLoadOptions options;
+        std::shared_ptr<const MappedFile> file;
+        // Without a mapping the file stays open, so sections are read from the
+        // same inode even if the path is replaced by a later save
+        mutable std::ifstream stream;
+        mutable std::mutex streamMutex;
+        ModelFileInfo info;
+        std::vector<SectionEntry> sections;
+    };
+}
@@ -0,0 +1,503 @@
+#include "server.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    // Largest media payload a single request may carry
+    const std::size_t MAX_PAYLOAD = 512 * 1024 * 1024;
+
+    MediaType parseMediaType(const std::string& name) {
+        if (name == "TEXT") return MediaType::TEXT;
+        if (name == "IMAGE") return MediaType::IMAGE;
+        if (name == "AUDIO") return MediaType::AUDIO;
+        if (name == "VIDEO") return MediaType::VIDEO;
+        throw std::invalid_argument("Invalid media type: " + name);
+    }
+
+    std::string ok(const std::string& payload = "") {
+        return payload.empty() ? "OK\n" : "OK " + payload + "\n";
+    }
+
+    // The request stream can no longer be split into requests, so the
+    // connection is closed instead of answering ERR and reading on
+    struct FramingError : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    // Byte count of the payload following a request line. Only TRAIN and
+    // PROCESS carry one, as their fourth field.
+    std::size_t payloadLength(std::string_view line) {
+        std::istringstream in{std::string(line)};
+        std::string command, id, type;
+        in >> command;
+        if (command != "TRAIN" && command != "PROCESS") {
+            return 0;
+        }
+        std::size_t length = 0;
+        if (!(in >> id >> type >> length) || length > MAX_PAYLOAD) {
+            throw FramingError("Missing or invalid payload length");
+        }
+        return length;
+    }
+}
+
+// Buffers requests from a connected socket without blocking. Workers read
+// whatever has arrived and only answer requests that are complete, so a
+// client that stalls mid-request leaves its connection with epoll rather
+// than holding a worker. The buffer grows with the bytes received, never
+// ahead of them.
+class MarketServer::LineConnection {
+public:
+    explicit LineConnection(int fd) : fd(fd) {}
+
+    // Reads until the socket has nothing more or the front request is
+    // complete; false once the client has closed the connection
+    bool receive() {
+        while (!hasRequest()) {
+            if (end == buffer.size()) makeRoom();
+            ssize_t n = ::recv(fd, buffer.data() + end, buffer.size() - end, MSG_DONTWAIT);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+            if (n <= 0) return false;
+            end += static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    // Takes the front request if all of it has arrived
+    bool nextRequest(std::string& line, std::vector<uint8_t>& payload) {
+        if (!hasRequest()) return false;
+        auto first = buffer.begin() + begin;
+        auto newline = std::find(first, buffer.begin() + end, '\n');
+        line.assign(first, newline);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        payload.assign(newline + 1, first + frame);
+        begin += frame;
+        frame = 0;
+        return true;
+    }
+
+    bool writeAll(const std::string& data) {
+        std::size_t written = 0;
+        while (written < data.size()) {
+            ssize_t n = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            written += static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+private:
+    static constexpr std::size_t MAX_LINE = 64 * 1024;
+
+    // True once the request line and its whole payload are buffered
+    bool hasRequest() {
+        if (frame == 0) {
+            auto first = buffer.begin() + begin;
+            auto newline = std::find(first, buffer.begin() + end, '\n');
+            if (newline == buffer.begin() + end) {
+                if (end - begin >= MAX_LINE) throw FramingError("Request line too long");
+                return false;
+            }
+            std::size_t lineLength = static_cast<std::size_t>(newline - first);
+            frame = lineLength + 1 + payloadLength(std::string_view(&*first, lineLength));
+        }
+        return end - begin >= frame;
+    }
+
+    // Frees space at the end of the buffer, doubling it at most up to the
+    // size of the request being received
+    void makeRoom() {
+        if (begin > 0) {
+            std::copy(buffer.begin() + begin, buffer.begin() + end, buffer.begin());
+            end -= begin;
+            begin = 0;
+        }
+        if (end == buffer.size()) {
+            std::size_t size = buffer.size() * 2;
+            if (frame != 0) size = std::min(size, frame);
+            buffer.resize(size);
+        }
+    }
+
+    int fd;
+    std::vector<char> buffer = std::vector<char>(4096);
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    std::size_t frame = 0;      // bytes of the front request, 0 until its line is complete
+};
+
+MarketServer::MarketServer(const ServerConfig& config)
+    : config(config), pending(config.pendingConnections) {
+    if (this->config.workers == 0) {
+        this->config.workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+MarketServer::~MarketServer() {
+    if (listenFd >= 0) {
+        ::close(listenFd);
+    }
+    if (epollFd >= 0) {
+        ::close(epollFd);
+    }
+}
+
+void MarketServer::run() {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (config.socketPath.empty() || config.socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Invalid socket path: " + config.socketPath);
+    }
+    std::strncpy(address.sun_path, config.socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    // A socket left behind by a previous run would make bind fail
+    struct stat st;
+    if (::stat(config.socketPath.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        ::unlink(config.socketPath.c_str());
+    }
+
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        throw std::runtime_error(std::string("Failed to create socket: ") + std::strerror(errno));
+    }
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listenFd, static_cast<int>(config.pendingConnections)) != 0) {
+        throw std::runtime_error("Failed to listen on '" + config.socketPath + "': " +
+                                 std::strerror(errno));
+    }
+
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listenFd;
+    if (epollFd < 0 || ::epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) != 0) {
+        throw std::runtime_error(std::string("Failed to set up epoll: ") + std::strerror(errno));
+    }
+
+    std::cout << "Serving on " << config.socketPath << " with " << config.workers
+              << " workers" << std::endl;
+    for (unsigned int i = 0; i < config.workers; ++i) {
+        workers.emplace_back(&MarketServer::workerLoop, this);
+    }
+
+    eventLoop();
+
+    // Stop taking connections, then unblock workers stuck in writes
+    ::close(listenFd);
+    listenFd = -1;
+    pending.close();
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        for (const auto& entry : connections) {
+            ::shutdown(entry.first, SHUT_RDWR);
+        }
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        for (const auto& entry : connections) {
+            ::close(entry.first);
+        }
+        connections.clear();
+    }
+    ::close(epollFd);
+    epollFd = -1;
+    ::unlink(config.socketPath.c_str());
+    std::cout << "Server stopped after " << requestCount << " requests" << std::endl;
+}
+
+void MarketServer::eventLoop() {
+    epoll_event events[64];
+    while (!stopRequested) {
+        // Wake up periodically so a stop request is noticed promptly
+        int ready = ::epoll_wait(epollFd, events, 64, 200);
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptConnection();
+            } else if (!pending.push(fd)) {
+                return;
+            }
+        }
+    }
+}
+
+void MarketServer::acceptConnection() {
+    int client = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client < 0) return;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        connections[client] = std::make_unique<LineConnection>(client);
+    }
+    // Reads never block, but a client that stops reading its responses
+    // gives its worker back after a while
+    timeval sendTimeout{30, 0};
+    ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+    // One-shot, so a connection is with exactly one worker while it is served
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = client;
+    if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, client, &event) != 0) {
+        closeConnection(client);
+    }
+}
+
+void MarketServer::workerLoop() {
+    while (auto fd = pending.pop()) {
+        LineConnection* connection = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            auto it = connections.find(*fd);
+            if (it != connections.end()) connection = it->second.get();
+        }
+        if (!connection) continue;
+
+        if (serveRequests(*connection)) {
+            // Back to the event loop until the client sends its next request
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLONESHOT;
+            event.data.fd = *fd;
+            if (::epoll_ctl(epollFd, EPOLL_CTL_MOD, *fd, &event) == 0) continue;
+        }
+        closeConnection(*fd);
+    }
+}
+
+void MarketServer::closeConnection(int fd) {
+    ::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        connections.erase(fd);
+    }
+    ::close(fd);
+}
+
+bool MarketServer::serveRequests(LineConnection& connection) {
+    std::string line;
+    std::vector<uint8_t> payload;
+    try {
+        // Requests that arrived whole are answered before the connection is
+        // rearmed; a partial one waits in the buffer for the rest of its bytes
+        bool open = connection.receive();
+        while (!stopRequested && connection.nextRequest(line, payload)) {
+            if (line.empty()) continue;
+            std::string response;
+            try {
+                response = handleRequest(line, payload);
+            } catch (const std::exception& e) {
+                response = std::string("ERR ") + e.what() + "\n";
+            }
+            requestCount++;
+            if (!connection.writeAll(response)) return false;
+        }
+        if (!open) return false;
+    } catch (const std::exception& e) {
+        // Protocol errors end the connection but not the server
+        connection.writeAll(std::string("ERR ") + e.what() + "\n");
+        return false;
+    }
+    return !stopRequested;
+}
+
+std::shared_ptr<MarketServer::ServedModel> MarketServer::findModel(const std::string& id) {
+    std::shared_lock<std::shared_mutex> lock(registryMutex);
+    auto it = models.find(id);
+    if (it == models.end()) {
+        throw std::runtime_error("Unknown model: " + id);
+    }
+    return it->second;
+}
+
+BatchScheduler& MarketServer::schedulerFor(ServedModel& served, MediaType type) {
+    std::lock_guard<std::mutex> lock(served.lock);
+    auto& scheduler = served.schedulers[type];
+    if (!scheduler) {
+        scheduler = std::make_unique<BatchScheduler>(served.current, type, config.batching);
+    }
+    return *scheduler;
+}
+
+std::string MarketServer::handleRequest(const std::string& line, std::vector<uint8_t>& payload) {
+    std::istringstream in(line);
+    std::string command;
+    in >> command;
+
+    if (command == "PING") {
+        return ok();
+    }
+
+    if (command == "CREATE") {
+        std::string name, typeList;
+        if (!(in >> name >> typeList)) throw std::runtime_error("Usage: CREATE <name> <TYPE>[,<TYPE>...]");
+        std::vector<MediaType> types;
+        std::istringstream list(typeList);
+        for (std::string type; std::getline(list, type, ',');) {
+            types.push_back(parseMediaType(type));
+        }
+
+        auto model = std::make_shared<AIModel>(name, types);
+        std::string id = model->getId();
+        // Storage keeps its own snapshot so later TRAIN steps never change
+        // a model the catalog is saving or handing out
+        storage.storeModel(model->clone());
+        auto served = std::make_shared<ServedModel>();
+        served->current = std::move(model);
+        {
+            std::lock_guard<std::mutex> lock(ledgerMutex);
+            ledger.addTransaction("CREATE", id, "system", "", 0.0);
+        }
+        std::unique_lock<std::shared_mutex> lock(registryMutex);
+        models.emplace(id, std::move(served));
+        return ok(id);
+    }
+
+    if (command == "TRAIN" || command == "PROCESS") {
+        std::string id, typeName;
+        in >> id >> typeName;
+        MediaType type = parseMediaType(typeName);
+        auto served = findModel(id);
+
+        if (command == "TRAIN") {
+            // PROCESS keeps running against the published version meanwhile
+            std::lock_guard<std::mutex> training(served->trainMutex);
+            std::shared_ptr<AIModel> next;
+            {
+                std::lock_guard<std::mutex> lock(served->lock);
+                next = served->current->clone();
+            }
+            std::span<const uint8_t> sample(payload);
+            next->trainBatch(type, std::span<const std::span<const uint8_t>>(&sample, 1));
+            storage.updateModel(next->clone());
+            {
+                std::lock_guard<std::mutex> lock(served->lock);
+                served->current = next;
+                for (auto& entry : served->schedulers) {
+                    entry.second->setModel(next);
+                }
+            }
+            std::ostringstream out;
+            out << next->getVersion() << " " << next->getAccuracy();
+            return ok(out.str());
+        }
+
+        std::vector<uint8_t> result = schedulerFor(*served, type).submit(std::move(payload)).get();
+        std::string response = ok(std::to_string(result.size()));
+        response.append(result.begin(), result.end());
+        return response;
+    }
+
+    if (command == "RENT") {
+        std::string id, renter, owner;
+        double amount = 0;
+        long seconds = 0;
+        if (!(in >> id >> renter >> owner >> amount >> seconds)) {
+            throw std::runtime_error("Usage: RENT <id> <renter> <owner> <amount> <seconds>");
+        }
+        std::lock_guard<std::mutex> lock(ledgerMutex);
+        ledger.addTransaction("RENT", id, renter, owner, amount, static_cast<std::time_t>(seconds));
+        return ok();
+    }
+
+    if (command == "RENTED") {
+        std::string id, user;
+        if (!(in >> id >> user)) throw std::runtime_error("Usage: RENTED <id> <user>");
+        std::lock_guard<std::mutex> lock(ledgerMutex);
+        return ok(ledger.isModelRentedBy(id, user) ? "1" : "0");
+    }
+
+    if (command == "AVAILABLE") {
+        std::string id;
+        if (!(in >> id)) throw std::runtime_error("Usage: AVAILABLE <id>");
+        std::lock_guard<std::mutex> lock(ledgerMutex);
+        return ok(ledger.isModelAvailableForRent(id) ? "1" : "0");
+    }
+
+    if (command == "VOTE") {
+        std::string id, voter;
+        int rating = 0;
+        if (!(in >> id >> voter >> rating)) throw std::runtime_error("Usage: VOTE <id> <voter> <rating> [review]");
+        std::string review;
+        std::getline(in >> std::ws, review);
+        std::lock_guard<std::mutex> lock(ledgerMutex);
+        ledger.addVote(id, voter, rating, review);
+        return ok();
+    }
+
+    if (command == "RATING" || command == "PRICE") {
+        std::string id;
+        if (!(in >> id)) throw std::runtime_error("Usage: " + command + " <id>");
+        std::lock_guard<std::mutex> lock(ledgerMutex);
+        double value = command == "RATING" ? ledger.getModelRating(id) : ledger.calculateFairPrice(id);
+        return ok(std::to_string(value));
+    }
+
+    if (command == "FIND") {
+        std::string typeList;
+        ModelQuery query;
+        if (!(in >> typeList >> query.minAccuracy)) {
+            throw std::runtime_error("Usage: FIND <TYPE>[,<TYPE>...]|* <min-accuracy> [limit]");
+        }
+        if (typeList != "*") {
+            std::istringstream list(typeList);
+            for (std::string type; std::getline(list, type, ',');) {
+                query.mediaTypes |= static_cast<uint32_t>(parseMediaType(type));
+            }
+        }
+        if (!(in >> query.limit)) {
+            query.limit = 100;
+        }
+        std::vector<ModelRecord> found = storage.findRecords(query);
+        std::ostringstream out;
+        out << found.size();
+        for (const auto& record : found) {
+            out << " " << record.id;
+        }
+        return ok(out.str());
+    }
+
+    if (command == "VERIFY") {
+        std::lock_guard<std::mutex> lock(ledgerMutex);
+        return ok(ledger.verifyChain() ? "1" : "0");
+    }
+
+    if (command == "STATS") {
+        std::size_t modelCount = 0;
+        {
+            std::shared_lock<std::shared_mutex> lock(registryMutex);
+            modelCount = models.size();
+        }
+        std::size_t openConnections = 0;
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            openConnections = connections.size();
+        }
+        std::ostringstream out;
+        out << "models=" << modelCount << " requests=" << requestCount.load()
+            << " connections=" << openConnections << " workers=" << config.workers;
+        return ok(out.str());
+    }
+
+    if (command == "SHUTDOWN") {
+        requestStop();
+        return ok();
+    }
+
+    throw std::runtime_error("Unknown command: " + command);
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "model.hpp"
+#include "storage.hpp"
+#include "blockchain.hpp"
+#include "batch_scheduler.hpp"
+#include "bounded_queue.hpp"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct ServerConfig {
+    std::string socketPath;
+    unsigned int workers = 0;           // request workers; 0 = one per core
+    std::size_t pendingConnections = 64;
+    // Dynamic batching for PROCESS requests; the window is short because
+    // interactive clients wait on every response
+    BatchConfig batching{32, std::chrono::microseconds(200)};
+};
+
+// Long-running aimarket daemon on a Unix domain socket. Models, the model
+// catalog and the ledger stay resident between requests. An epoll loop
+// watches every open connection and hands those with a request waiting to
+// a fixed pool of workers. A request is answered once all of its bytes have
+// arrived, so neither idle clients nor ones stalled part-way through a
+// request hold a worker.
+//
+// The protocol is line based: one request line per command, answered by a
+// line starting with "OK" or "ERR". Commands carrying media append a byte
+// count and the raw bytes follow the request line; PROCESS results come
+// back the same way. A malformed byte count closes the connection, since
+// the rest of the stream can no longer be split into requests.
+//
+//   PING                                   OK
+//   CREATE <name> <TYPE>[,<TYPE>...]       OK <id>
+//   TRAIN <id> <TYPE> <n>\n<n bytes>       OK <version> <accuracy>
+//   PROCESS <id> <TYPE> <n>\n<n bytes>     OK <m>\n<m bytes>
+//   RENT <id> <renter> <owner> <amount> <seconds>
+//   RENTED <id> <user>                     OK 0|1
+//   AVAILABLE <id>                         OK 0|1
+//   VOTE <id> <voter> <rating> [review]
+//   RATING <id>                            OK <rating>
+//   PRICE <id>                             OK <price>
+//   FIND <TYPE>[,<TYPE>...]|* <min-accuracy> [limit]
+//                                          OK <n> <id>... (best accuracy first)
+//   VERIFY                                 OK 0|1
+//   STATS                                  OK models=<n> requests=<n> ...
+//   SHUTDOWN                               OK
+class MarketServer {
+public:
+    explicit MarketServer(const ServerConfig& config);
+    ~MarketServer();
+
+    MarketServer(const MarketServer&) = delete;
+    MarketServer& operator=(const MarketServer&) = delete;
+
+    // Binds the socket and serves until requestStop() or SHUTDOWN
+    void run();
+    // Safe to call from a signal handler
+    void requestStop() noexcept { stopRequested = true; }
+
+private:
+    // A published model is never modified: TRAIN trains a clone outside the
+    // lock and swaps it in, so a running batch always sees one whole version
+    struct ServedModel {
+        std::mutex lock;                    // guards current and schedulers
+        std::shared_ptr<const AIModel> current;
+        std::map<MediaType, std::unique_ptr<BatchScheduler>> schedulers;
+        std::mutex trainMutex;              // TRAIN steps run one at a time
+    };
+
+    class LineConnection;
+
+    void eventLoop();
+    void acceptConnection();
+    void workerLoop();
+    // Answers the requests waiting on a connection; false once it should close
+    bool serveRequests(LineConnection& connection);
+    void closeConnection(int fd);
+    // Answers one complete request; payload holds the bytes announced by its line
+    std::string handleRequest(const std::string& line, std::vector<uint8_t>& payload);
+
+    std::shared_ptr<ServedModel> findModel(const std::string& id);
+    BatchScheduler& schedulerFor(ServedModel& served, MediaType type);
+
+    ServerConfig config;
+    int listenFd = -1;
+    int epollFd = -1;
+    std::atomic<bool> stopRequested{false};
+    std::atomic<std::size_t> requestCount{0};
+
+    std::shared_mutex registryMutex;
+    std::unordered_map<std::string, std::shared_ptr<ServedModel>> models;
+    ModelStorage storage;
+    std::mutex ledgerMutex;
+    BlockchainLedger ledger;
+
+    std::mutex connectionsMutex;
+    std::unordered_map<int, std::unique_ptr<LineConnection>> connections;
+    std::vector<std::thread> workers;
+    // Connections with a request waiting, disarmed in epoll until served
+    BoundedQueue<int> pending;
+};
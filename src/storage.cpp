@@ -1,27 +1,423 @@
 #include "storage.hpp"
+#include "utils.hpp"
 #include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
 
-void ModelStorage::storeModel(const AIModel& model) {
-    models.push_back(model);
+namespace {
+    const char CATALOG_MAGIC[8] = {'A', 'I', 'M', 'C', 'A', 'T', '1', '\0'};
+
+    template <typename T>
+    void put(std::vector<uint8_t>& out, const T& value) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    void putString(std::vector<uint8_t>& out, const std::string& value) {
+        put(out, static_cast<uint32_t>(value.size()));
+        out.insert(out.end(), value.begin(), value.end());
+    }
+
+    class CatalogReader {
+    public:
+        CatalogReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+        template <typename T>
+        T get() {
+            require(sizeof(T));
+            T value;
+            std::memcpy(&value, data + offset, sizeof(T));
+            offset += sizeof(T);
+            return value;
+        }
+
+        std::string getString() {
+            uint32_t length = get<uint32_t>();
+            require(length);
+            std::string value(reinterpret_cast<const char*>(data + offset), length);
+            offset += length;
+            return value;
+        }
+
+    private:
+        void require(size_t length) {
+            if (length > size - offset) {
+                throw std::runtime_error("Truncated model catalog");
+            }
+        }
+
+        const uint8_t* data;
+        size_t size;
+        size_t offset = 0;
+    };
+
+    // Bits of the four MediaType flags
+    constexpr uint32_t MEDIA_TYPE_MASK = 0xF;
+}
+
+ModelRecord ModelRecord::describe(const AIModel& model) {
+    ModelRecord record;
+    record.id = model.getId();
+    record.name = model.getName();
+    record.version = model.getVersion();
+    record.accuracy = model.getAccuracy();
+    record.validated = model.isValidated();
+    for (MediaType type : model.getSupportedTypes()) {
+        record.mediaTypes |= static_cast<uint32_t>(type);
+    }
+    return record;
+}
+
+ModelStorage::ModelStorage(const std::string& catalogPath)
+    : catalogPath(catalogPath) {
+    if (!catalogPath.empty() && std::filesystem::exists(catalogPath)) {
+        loadCatalog();
+    }
+}
+
+void ModelStorage::indexLocked(const Entry& entry) {
+    const ModelRecord& record = entry.record;
+    size_t word = entry.position / 64;
+    uint64_t bit = uint64_t(1) << (entry.position % 64);
+    for (uint32_t types = record.mediaTypes & MEDIA_TYPE_MASK; types; types &= types - 1) {
+        auto& bitmap = typeBitmaps[std::countr_zero(types)];
+        if (bitmap.size() <= word) {
+            bitmap.resize(word + 1, 0);
+        }
+        bitmap[word] |= bit;
+    }
+    byAccuracy.emplace(record.accuracy, record.id);
+    byName[record.name].emplace(record.version, record.id);
+}
+
+void ModelStorage::unindexLocked(const Entry& entry) {
+    const ModelRecord& record = entry.record;
+    size_t word = entry.position / 64;
+    uint64_t bit = uint64_t(1) << (entry.position % 64);
+    for (uint32_t types = record.mediaTypes & MEDIA_TYPE_MASK; types; types &= types - 1) {
+        typeBitmaps[std::countr_zero(types)][word] &= ~bit;
+    }
+    auto [first, last] = byAccuracy.equal_range(record.accuracy);
+    for (auto it = first; it != last; ++it) {
+        if (it->second == record.id) {
+            byAccuracy.erase(it);
+            break;
+        }
+    }
+    auto versions = byName.find(record.name);
+    versions->second.erase({record.version, record.id});
+    if (versions->second.empty()) {
+        byName.erase(versions);
+    }
+}
+
+void ModelStorage::replaceLocked(Entry& entry, ModelRecord record) {
+    unindexLocked(entry);
+    entry.record = std::move(record);
+    indexLocked(entry);
+}
+
+void ModelStorage::insertLocked(ModelRecord record, ModelHandle handle) {
+    auto it = index.find(record.id);
+    if (it != index.end()) {
+        replaceLocked(it->second, std::move(record));
+        it->second.handle = std::move(handle);
+        return;
+    }
+    std::string id = record.id;
+    order.push_back(id);
+    auto inserted = index.emplace(std::move(id), Entry{std::move(record), std::move(handle), order.size() - 1});
+    indexLocked(inserted.first->second);
+}
+
+void ModelStorage::storeModel(ModelHandle model) {
+    if (!model) {
+        throw std::invalid_argument("Cannot store a null model");
+    }
+    ModelRecord record = ModelRecord::describe(*model);
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    insertLocked(std::move(record), std::move(model));
+}
+
+bool ModelStorage::updateModel(ModelHandle model) {
+    if (!model) {
+        return false;
+    }
+    ModelRecord record = ModelRecord::describe(*model);
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = index.find(record.id);
+    if (it == index.end()) {
+        return false;
+    }
+    replaceLocked(it->second, std::move(record));
+    it->second.handle = std::move(model);
+    return true;
+}
+
+bool ModelStorage::removeModel(const std::string& id) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = index.find(id);
+    if (it == index.end()) {
+        return false;
+    }
+    unindexLocked(it->second);
+    // Keep order dense: the last id takes the removed slot
+    size_t position = it->second.position;
+    if (position != order.size() - 1) {
+        Entry& moved = index.at(order.back());
+        unindexLocked(moved);
+        order[position] = std::move(order.back());
+        moved.position = position;
+        indexLocked(moved);
+    }
+    order.pop_back();
+    index.erase(it);
+    return true;
+}
+
+ModelHandle ModelStorage::getModel(const std::string& id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = index.find(id);
+    return it != index.end() ? it->second.handle : nullptr;
+}
+
+std::optional<ModelRecord> ModelStorage::getRecord(const std::string& id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = index.find(id);
+    if (it == index.end()) {
+        return std::nullopt;
+    }
+    return it->second.record;
+}
+
+bool ModelStorage::contains(const std::string& id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return index.find(id) != index.end();
+}
+
+size_t ModelStorage::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return order.size();
+}
+
+std::vector<ModelRecord> ModelStorage::listRecords(size_t offset, size_t limit) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<ModelRecord> page;
+    if (offset >= order.size()) {
+        return page;
+    }
+    size_t end = offset + std::min(limit, order.size() - offset);
+    page.reserve(end - offset);
+    for (size_t i = offset; i < end; ++i) {
+        page.push_back(index.at(order[i]).record);
+    }
+    return page;
+}
+
+std::vector<ModelHandle> ModelStorage::listModels(size_t offset, size_t limit) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<ModelHandle> page;
+    if (offset >= order.size()) {
+        return page;
+    }
+    size_t end = offset + std::min(limit, order.size() - offset);
+    page.reserve(end - offset);
+    for (size_t i = offset; i < end; ++i) {
+        if (const auto& handle = index.at(order[i]).handle) {
+            page.push_back(handle);
+        }
+    }
+    return page;
+}
+
+std::vector<uint64_t> ModelStorage::typeBitmapLocked(uint32_t mediaTypes) const {
+    std::vector<uint64_t> bitmap;
+    if (mediaTypes == 0 || (mediaTypes & ~MEDIA_TYPE_MASK) != 0) {
+        return bitmap;
+    }
+    size_t words = SIZE_MAX;
+    for (uint32_t types = mediaTypes; types; types &= types - 1) {
+        words = std::min(words, typeBitmaps[std::countr_zero(types)].size());
+    }
+    bitmap.assign(words, ~uint64_t(0));
+    for (uint32_t types = mediaTypes; types; types &= types - 1) {
+        const auto& typeBitmap = typeBitmaps[std::countr_zero(types)];
+        for (size_t word = 0; word < words; ++word) {
+            bitmap[word] &= typeBitmap[word];
+        }
+    }
+    return bitmap;
+}
+
+bool ModelStorage::matchesLocked(const Entry& entry, const ModelQuery& query) const {
+    const ModelRecord& record = entry.record;
+    if ((record.mediaTypes & query.mediaTypes) != query.mediaTypes ||
+        record.accuracy < query.minAccuracy || record.accuracy > query.maxAccuracy ||
+        (query.validatedOnly && !record.validated) ||
+        (!query.name.empty() && record.name != query.name)) {
+        return false;
+    }
+    return !query.latestOnly || byName.at(record.name).rbegin()->second == record.id;
+}
+
+template <typename Visit>
+void ModelStorage::scanLocked(const ModelQuery& query, Visit visit) const {
+    // Narrowest index first: a name pins down a handful of versions, media
+    // type bitmaps are intersected a word at a time when accuracy is
+    // unconstrained, and everything else walks the accuracy index
+    std::vector<const Entry*> candidates;
+    if (!query.name.empty()) {
+        auto versions = byName.find(query.name);
+        if (versions == byName.end()) {
+            return;
+        }
+        for (const auto& [version, id] : versions->second) {
+            candidates.push_back(&index.at(id));
+        }
+    } else if (query.mediaTypes != 0 && query.minAccuracy == -std::numeric_limits<double>::infinity() &&
+               query.maxAccuracy == std::numeric_limits<double>::infinity()) {
+        std::vector<uint64_t> bitmap = typeBitmapLocked(query.mediaTypes);
+        for (size_t word = 0; word < bitmap.size(); ++word) {
+            for (uint64_t bits = bitmap[word]; bits; bits &= bits - 1) {
+                candidates.push_back(&index.at(order[word * 64 + std::countr_zero(bits)]));
+            }
+        }
+    } else {
+        auto first = byAccuracy.lower_bound(query.minAccuracy);
+        for (auto it = byAccuracy.upper_bound(query.maxAccuracy); it != first;) {
+            --it;
+            const Entry& entry = index.at(it->second);
+            if (matchesLocked(entry, query) && !visit(entry)) {
+                return;
+            }
+        }
+        return;
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b) {
+        return a->record.accuracy > b->record.accuracy;
+    });
+    for (const Entry* entry : candidates) {
+        if (matchesLocked(*entry, query) && !visit(*entry)) {
+            return;
+        }
+    }
 }
 
-void ModelStorage::updateModel(const AIModel& model) {
-    auto it = std::find_if(models.begin(), models.end(),
-                          [&](const AIModel& m) { return m.getId() == model.getId(); });
-    if (it != models.end()) {
-        *it = model;
+std::vector<ModelRecord> ModelStorage::findRecords(const ModelQuery& query) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<ModelRecord> page;
+    size_t skipped = 0;
+    if (query.limit == 0) {
+        return page;
     }
+    scanLocked(query, [&](const Entry& entry) {
+        if (skipped < query.offset) {
+            skipped++;
+            return true;
+        }
+        page.push_back(entry.record);
+        return page.size() < query.limit;
+    });
+    return page;
 }
 
-std::optional<AIModel> ModelStorage::getModel(const std::string& id) {
-    auto it = std::find_if(models.begin(), models.end(),
-                          [&](const AIModel& m) { return m.getId() == id; });
-    if (it != models.end()) {
-        return *it;
+size_t ModelStorage::countMatching(const ModelQuery& query) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    size_t count = 0;
+    bool typesOnly = query.name.empty() && !query.validatedOnly && !query.latestOnly &&
+                     query.minAccuracy == -std::numeric_limits<double>::infinity() &&
+                     query.maxAccuracy == std::numeric_limits<double>::infinity();
+    if (typesOnly && query.mediaTypes != 0) {
+        for (uint64_t bits : typeBitmapLocked(query.mediaTypes)) {
+            count += std::popcount(bits);
+        }
+        return count;
+    }
+    scanLocked(query, [&](const Entry&) {
+        count++;
+        return true;
+    });
+    return count;
+}
+
+std::optional<ModelRecord> ModelStorage::getLatestVersion(const std::string& name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto versions = byName.find(name);
+    if (versions == byName.end()) {
+        return std::nullopt;
+    }
+    return index.at(versions->second.rbegin()->second).record;
+}
+
+void ModelStorage::saveCatalog() const {
+    if (catalogPath.empty()) {
+        return;
+    }
+
+    std::vector<uint8_t> out(CATALOG_MAGIC, CATALOG_MAGIC + sizeof(CATALOG_MAGIC));
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        put(out, static_cast<uint64_t>(order.size()));
+        for (const auto& id : order) {
+            const ModelRecord& record = index.at(id).record;
+            putString(out, record.id);
+            putString(out, record.name);
+            put(out, static_cast<uint32_t>(record.version));
+            put(out, record.accuracy);
+            put(out, record.mediaTypes);
+            put(out, static_cast<uint8_t>(record.validated));
+        }
+    }
+    put(out, utils::checksum64(out.data(), out.size()));
+
+    std::filesystem::path parent = std::filesystem::path(catalogPath).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent);
     }
-    return std::nullopt;
+    utils::saveBinaryFile(catalogPath, out, true);
 }
 
-std::vector<AIModel> ModelStorage::listModels() {
-    return models;
+void ModelStorage::loadCatalog() {
+    if (catalogPath.empty()) {
+        return;
+    }
+
+    utils::FileBuffer file = utils::loadFile(catalogPath);
+    if (file.size() < sizeof(CATALOG_MAGIC) + 2 * sizeof(uint64_t) ||
+        std::memcmp(file.data(), CATALOG_MAGIC, sizeof(CATALOG_MAGIC)) != 0) {
+        throw std::runtime_error("Not a model catalog: " + catalogPath);
+    }
+    size_t bodySize = file.size() - sizeof(uint64_t);
+    uint64_t stored;
+    std::memcpy(&stored, file.data() + bodySize, sizeof(stored));
+    if (utils::checksum64(file.data(), bodySize) != stored) {
+        throw std::runtime_error("Model catalog checksum mismatch: " + catalogPath);
+    }
+
+    CatalogReader reader(file.data() + sizeof(CATALOG_MAGIC), bodySize - sizeof(CATALOG_MAGIC));
+    uint64_t count = reader.get<uint64_t>();
+    std::vector<ModelRecord> records;
+    for (uint64_t i = 0; i < count; ++i) {
+        ModelRecord record;
+        record.id = reader.getString();
+        record.name = reader.getString();
+        record.version = reader.get<uint32_t>();
+        record.accuracy = reader.get<double>();
+        record.mediaTypes = reader.get<uint32_t>();
+        record.validated = reader.get<uint8_t>() != 0;
+        records.push_back(std::move(record));
+    }
+
+    // Resident models keep their handles; everything else is metadata only
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    for (auto& record : records) {
+        auto it = index.find(record.id);
+        if (it == index.end()) {
+            insertLocked(std::move(record), nullptr);
+        }
+    }
 }
@@ -1,15 +1,111 @@
 #pragma once
 #include "model.hpp"
 #include <vector>
+#include <array>
+#include <limits>
+#include <map>
 #include <optional>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
 
+// Shared read-only reference to a stored model; copying one never copies weights
+using ModelHandle = std::shared_ptr<const AIModel>;
+
+// Catalog metadata kept for every stored model and persisted to disk
+struct ModelRecord {
+    std::string id;
+    std::string name;
+    unsigned int version = 0;
+    double accuracy = 0.0;
+    uint32_t mediaTypes = 0;    // MediaType flags OR-ed together
+    bool validated = false;
+
+    static ModelRecord describe(const AIModel& model);
+    bool supports(MediaType type) const { return (mediaTypes & static_cast<uint32_t>(type)) != 0; }
+};
+
+// Catalog query. All given conditions must hold; results come back ordered
+// by accuracy, best first.
+struct ModelQuery {
+    uint32_t mediaTypes = 0;    // MediaType flags the model must all support
+    double minAccuracy = -std::numeric_limits<double>::infinity();
+    double maxAccuracy = std::numeric_limits<double>::infinity();   // inclusive
+    std::string name;           // exact name; empty matches any
+    bool validatedOnly = false;
+    bool latestOnly = false;    // only the highest version stored under each name
+    size_t offset = 0;
+    size_t limit = SIZE_MAX;
+};
+
+// Model catalog with a hash index by id. Models are held through handles, so
+// storing, looking up and listing them is O(1) per model and copies no
+// weight data. Secondary indexes (a bitmap per media type over catalog
+// positions, an ordered accuracy index and the versions stored under each
+// name) are kept up to date on every change and answer findRecords(). With
+// a catalog path, metadata survives restarts: models come back as records
+// without a resident handle until they are stored again.
+// All methods are safe to call concurrently.
 class ModelStorage {
 public:
-    void storeModel(const AIModel& model);
-    void updateModel(const AIModel& model);
-    std::optional<AIModel> getModel(const std::string& id);
-    std::vector<AIModel> listModels();
-    
+    explicit ModelStorage(const std::string& catalogPath = "");
+
+    // Adds the model or replaces the entry with the same id
+    void storeModel(ModelHandle model);
+    // Replaces an existing entry, refreshing its metadata; false if unknown
+    bool updateModel(ModelHandle model);
+    bool removeModel(const std::string& id);
+
+    // nullptr if the id is unknown or the model is not resident
+    ModelHandle getModel(const std::string& id) const;
+    std::optional<ModelRecord> getRecord(const std::string& id) const;
+    bool contains(const std::string& id) const;
+    size_t size() const;
+
+    // Pages through the catalog in a stable order; removals move the last
+    // entry into the freed position
+    std::vector<ModelRecord> listRecords(size_t offset, size_t limit) const;
+    std::vector<ModelHandle> listModels(size_t offset = 0, size_t limit = SIZE_MAX) const;
+
+    std::vector<ModelRecord> findRecords(const ModelQuery& query) const;
+    size_t countMatching(const ModelQuery& query) const;
+    // Highest version stored under name
+    std::optional<ModelRecord> getLatestVersion(const std::string& name) const;
+
+    // Writes or re-reads the catalog file; no-ops without a catalog path
+    void saveCatalog() const;
+    void loadCatalog();
+
 private:
-    std::vector<AIModel> models;
+    struct Entry {
+        ModelRecord record;
+        ModelHandle handle;
+        size_t position;    // index into order
+    };
+
+    void insertLocked(ModelRecord record, ModelHandle handle);
+    void replaceLocked(Entry& entry, ModelRecord record);
+    void indexLocked(const Entry& entry);
+    void unindexLocked(const Entry& entry);
+    // Positions supporting every type in mediaTypes, one bit per position
+    std::vector<uint64_t> typeBitmapLocked(uint32_t mediaTypes) const;
+    bool matchesLocked(const Entry& entry, const ModelQuery& query) const;
+    // Calls visit for matching entries, best accuracy first, until it returns false
+    template <typename Visit>
+    void scanLocked(const ModelQuery& query, Visit visit) const;
+
+    using VersionKey = std::pair<unsigned int, std::string>;
+
+    std::string catalogPath;
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, Entry> index;
+    std::vector<std::string> order;
+    std::array<std::vector<uint64_t>, 4> typeBitmaps;   // bit per position, by MediaType bit
+    std::multimap<double, std::string> byAccuracy;
+    std::unordered_map<std::string, std::set<VersionKey>> byName;
 };
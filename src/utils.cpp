@@ -2,6 +2,13 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 namespace utils {
     std::string hashString(const std::string& input) {
@@ -13,14 +20,272 @@ namespace utils {
         return ss.str();
     }
     
+    namespace {
+        // Below this size a plain read is cheaper than setting up a mapping
+        const std::size_t MAP_THRESHOLD = 1 << 20;
+
+        std::runtime_error fileError(const std::string& what, const std::string& path) {
+            return std::runtime_error(what + " '" + path + "': " + std::strerror(errno));
+        }
+
+        // Reads until buffer is full or EOF; returns the number of bytes read
+        std::size_t readAll(int fd, const std::string& path, uint8_t* buffer, std::size_t length) {
+            std::size_t total = 0;
+            while (total < length) {
+                ssize_t n = ::read(fd, buffer + total, length - total);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    throw fileError("Failed to read", path);
+                }
+                if (n == 0) break;
+                total += static_cast<std::size_t>(n);
+            }
+            return total;
+        }
+
+        std::vector<uint8_t> readFile(const std::string& path) {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                throw fileError("Failed to open", path);
+            }
+            struct stat st;
+            if (::fstat(fd, &st) != 0) {
+                int savedErrno = errno;
+                ::close(fd);
+                errno = savedErrno;
+                throw fileError("Failed to stat", path);
+            }
+
+            std::vector<uint8_t> bytes;
+            try {
+                if (S_ISREG(st.st_mode) && st.st_size > 0) {
+                    bytes.resize(static_cast<std::size_t>(st.st_size));
+                    bytes.resize(readAll(fd, path, bytes.data(), bytes.size()));
+                } else {
+                    // Pipes and special files report no size; read until EOF
+                    const std::size_t chunk = 64 * 1024;
+                    std::size_t used = 0;
+                    std::size_t n;
+                    do {
+                        bytes.resize(used + chunk);
+                        n = readAll(fd, path, bytes.data() + used, chunk);
+                        used += n;
+                    } while (n == chunk);
+                    bytes.resize(used);
+                }
+            } catch (...) {
+                ::close(fd);
+                throw;
+            }
+            ::close(fd);
+            return bytes;
+        }
+    }
+
+    FileBuffer loadFile(const std::string& path, LoadMode mode) {
+        if (mode == LoadMode::AUTO) {
+            struct stat st;
+            if (::stat(path.c_str(), &st) != 0) {
+                throw fileError("Failed to stat", path);
+            }
+            bool large = S_ISREG(st.st_mode) && static_cast<std::size_t>(st.st_size) >= MAP_THRESHOLD;
+            mode = large ? LoadMode::MAP : LoadMode::READ;
+        }
+
+        if (mode == LoadMode::MAP) {
+            MapOptions options;
+            options.advice = MapAdvice::SEQUENTIAL;
+            return FileBuffer(MappedFile::open(path, options));
+        }
+        return FileBuffer(readFile(path));
+    }
+
     std::vector<uint8_t> loadBinaryFile(const std::string& path) {
-        std::ifstream file(path, std::ios::binary);
-        return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)),
-                                   std::istreambuf_iterator<char>());
+        return readFile(path);
     }
-    
-    void saveBinaryFile(const std::string& path, const std::vector<uint8_t>& data) {
-        std::ofstream file(path, std::ios::binary);
-        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+    void saveBinaryFile(const std::string& path, std::span<const uint8_t> data, bool atomic) {
+        saveBinaryFile(path, std::span<const std::span<const uint8_t>>(&data, 1), atomic);
+    }
+
+    void saveBinaryFile(const std::string& path, std::span<const std::span<const uint8_t>> pieces,
+                        bool atomic) {
+        // The counter keeps threads saving the same path off each other's
+        // temporary file; O_EXCL catches anything left over with that name
+        static std::atomic<unsigned long> saveCounter{0};
+        std::string target = atomic ? path + ".tmp." + std::to_string(::getpid()) + "." +
+                                          std::to_string(saveCounter++)
+                                    : path;
+        int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (atomic ? O_EXCL : O_TRUNC);
+        int fd = ::open(target.c_str(), flags, 0644);
+        if (fd < 0) {
+            throw fileError("Failed to create", target);
+        }
+
+        for (std::span<const uint8_t> data : pieces) {
+            std::size_t written = 0;
+            while (written < data.size()) {
+                ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    int savedErrno = errno;
+                    ::close(fd);
+                    if (atomic) ::unlink(target.c_str());
+                    errno = savedErrno;
+                    throw fileError("Failed to write", target);
+                }
+                written += static_cast<std::size_t>(n);
+            }
+        }
+
+        if (atomic && ::fsync(fd) != 0) {
+            int savedErrno = errno;
+            ::close(fd);
+            ::unlink(target.c_str());
+            errno = savedErrno;
+            throw fileError("Failed to sync", target);
+        }
+        if (::close(fd) != 0) {
+            if (atomic) ::unlink(target.c_str());
+            throw fileError("Failed to close", target);
+        }
+        if (atomic && ::rename(target.c_str(), path.c_str()) != 0) {
+            int savedErrno = errno;
+            ::unlink(target.c_str());
+            errno = savedErrno;
+            throw fileError("Failed to replace", path);
+        }
+    }
+
+    namespace {
+        constexpr std::uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+        constexpr std::uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+        constexpr std::uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+        constexpr std::uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+        constexpr std::uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+        inline std::uint64_t rotl(std::uint64_t x, int r) {
+            return (x << r) | (x >> (64 - r));
+        }
+
+        inline std::uint64_t read64(const std::uint8_t* p) {
+            std::uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline std::uint32_t read32(const std::uint8_t* p) {
+            std::uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline std::uint64_t round(std::uint64_t acc, std::uint64_t input) {
+            acc += input * PRIME2;
+            acc = rotl(acc, 31);
+            return acc * PRIME1;
+        }
+
+        inline std::uint64_t mergeRound(std::uint64_t acc, std::uint64_t val) {
+            acc ^= round(0, val);
+            return acc * PRIME1 + PRIME4;
+        }
+
+        inline std::uint64_t mergeLanes(const std::uint64_t (&v)[4]) {
+            std::uint64_t h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+            for (std::uint64_t lane : v) {
+                h = mergeRound(h, lane);
+            }
+            return h;
+        }
+
+        // Folds in the last fewer than 32 bytes and mixes the result
+        std::uint64_t finish(std::uint64_t h, const std::uint8_t* p, const std::uint8_t* end) {
+            while (p + 8 <= end) {
+                h ^= round(0, read64(p));
+                h = rotl(h, 27) * PRIME1 + PRIME4;
+                p += 8;
+            }
+            if (p + 4 <= end) {
+                h ^= static_cast<std::uint64_t>(read32(p)) * PRIME1;
+                h = rotl(h, 23) * PRIME2 + PRIME3;
+                p += 4;
+            }
+            while (p < end) {
+                h ^= (*p) * PRIME5;
+                h = rotl(h, 11) * PRIME1;
+                ++p;
+            }
+
+            h ^= h >> 33;
+            h *= PRIME2;
+            h ^= h >> 29;
+            h *= PRIME3;
+            h ^= h >> 32;
+            return h;
+        }
+    }
+
+    std::uint64_t checksum64(const void* data, std::size_t length, std::uint64_t seed) {
+        const std::uint8_t* p = static_cast<const std::uint8_t*>(data);
+        const std::uint8_t* const end = p + length;
+        std::uint64_t h;
+
+        if (length >= 32) {
+            // Four independent lanes keep the multiplier pipelines busy
+            std::uint64_t v[4] = {seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1};
+            const std::uint8_t* const limit = end - 32;
+            do {
+                v[0] = round(v[0], read64(p));
+                v[1] = round(v[1], read64(p + 8));
+                v[2] = round(v[2], read64(p + 16));
+                v[3] = round(v[3], read64(p + 24));
+                p += 32;
+            } while (p <= limit);
+            h = mergeLanes(v);
+        } else {
+            h = seed + PRIME5;
+        }
+
+        h += static_cast<std::uint64_t>(length);
+        return finish(h, p, end);
+    }
+
+    Checksum64::Checksum64(std::uint64_t seed)
+        : seed(seed), lanes{seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1} {}
+
+    void Checksum64::update(const void* data, std::size_t length) {
+        const std::uint8_t* p = static_cast<const std::uint8_t*>(data);
+        const std::uint8_t* const end = p + length;
+        total += length;
+
+        if (tailSize + length < 32) {
+            std::memcpy(tail + tailSize, p, length);
+            tailSize += length;
+            return;
+        }
+        if (tailSize > 0) {
+            std::size_t fill = 32 - tailSize;
+            std::memcpy(tail + tailSize, p, fill);
+            for (int i = 0; i < 4; ++i) {
+                lanes[i] = round(lanes[i], read64(tail + 8 * i));
+            }
+            p += fill;
+            tailSize = 0;
+        }
+        while (p + 32 <= end) {
+            for (int i = 0; i < 4; ++i) {
+                lanes[i] = round(lanes[i], read64(p + 8 * i));
+            }
+            p += 32;
+        }
+        tailSize = static_cast<std::size_t>(end - p);
+        std::memcpy(tail, p, tailSize);
+    }
+
+    std::uint64_t Checksum64::digest() const {
+        std::uint64_t h = total >= 32 ? mergeLanes(lanes) : seed + PRIME5;
+        h += total;
+        return finish(h, tail, tail + tailSize);
     }
-}
+}
\ No newline at end of file
@@ -1,10 +1,69 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <memory>
+#include <span>
 #include <cstdint>
+#include <cstddef>
+#include "mapped_file.hpp"
 
 namespace utils {
+    // Contents of a loaded file: an owned heap buffer or a read-only mapping
+    class FileBuffer {
+    public:
+        FileBuffer() = default;
+        explicit FileBuffer(std::vector<std::uint8_t> bytes) : owned(std::move(bytes)) {}
+        explicit FileBuffer(std::shared_ptr<const MappedFile> file) : mapping(std::move(file)) {}
+
+        const std::uint8_t* data() const { return mapping ? mapping->data() : owned.data(); }
+        std::size_t size() const { return mapping ? mapping->size() : owned.size(); }
+        bool isMapped() const { return mapping != nullptr; }
+        std::span<const std::uint8_t> span() const { return std::span<const std::uint8_t>(data(), size()); }
+
+    private:
+        std::vector<std::uint8_t> owned;
+        std::shared_ptr<const MappedFile> mapping;
+    };
+
+    enum class LoadMode {
+        AUTO,   // map large files, read small ones
+        READ,   // one pre-sized read into the heap
+        MAP     // read-only memory mapping
+    };
+
     std::string hashString(const std::string& input);
+
+    // Loaders stat the file and read it with a single pre-sized read (or map
+    // it); failures throw std::runtime_error naming the path and the cause
+    FileBuffer loadFile(const std::string& path, LoadMode mode = LoadMode::AUTO);
     std::vector<std::uint8_t> loadBinaryFile(const std::string& path);
-    void saveBinaryFile(const std::string& path, const std::vector<std::uint8_t>& data);
-}
\ No newline at end of file
+
+    // With atomic set, data goes to a temporary file in the same directory
+    // that is synced and renamed over path, so readers never see a partial file
+    void saveBinaryFile(const std::string& path, std::span<const std::uint8_t> data,
+                        bool atomic = false);
+    // Writes the pieces back to back, for files assembled from separate buffers
+    void saveBinaryFile(const std::string& path,
+                        std::span<const std::span<const std::uint8_t>> pieces,
+                        bool atomic = false);
+
+    // Fast non-cryptographic 64-bit checksum (XXH64) for integrity checks
+    std::uint64_t checksum64(const void* data, std::size_t length, std::uint64_t seed = 0);
+
+    // checksum64 over data that arrives in pieces: the digest is that of
+    // the pieces back to back, however they were split
+    class Checksum64 {
+    public:
+        explicit Checksum64(std::uint64_t seed = 0);
+
+        void update(const void* data, std::size_t length);
+        std::uint64_t digest() const;
+
+    private:
+        std::uint64_t seed;
+        std::uint64_t lanes[4];
+        std::uint64_t total = 0;
+        std::uint8_t tail[32];      // input not yet folded into the lanes
+        std::size_t tailSize = 0;
+    };
+}
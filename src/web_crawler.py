@@ -11,9 +11,29 @@ from selenium.webdriver.common.by import By
 from selenium.webdriver.support.ui import WebDriverWait
 from selenium.webdriver.support import expected_conditions as EC
 import time
+import struct
+import errno
+import os
+
+def write_document(stream, source, text):
+    """Writes one length-prefixed record: two little-endian uint32 lengths, then the bytes."""
+    source_bytes = source.encode('utf-8')
+    text_bytes = text.encode('utf-8')
+    stream.write(struct.pack('<II', len(source_bytes), len(text_bytes)))
+    stream.write(source_bytes)
+    stream.write(text_bytes)
+    stream.flush()
+
+def is_broken_pipe(error):
+    """True when a write failed because the reading end of the pipe has closed."""
+    return isinstance(error, BrokenPipeError) or (
+        isinstance(error, OSError) and error.errno == errno.EPIPE)
 
 class WebCrawler:
-    def __init__(self, max_depth=3, max_pages=100, goal=None):
+    def __init__(self, max_depth=3, max_pages=100, goal=None, document_stream=None):
+        # With a document stream, relevant pages are written to it as records
+        # instead of temp files, and progress goes to stderr
+        self.document_stream = document_stream
         self.visited_urls = set()
         self.max_depth = max_depth
         self.max_pages = max_pages
@@ -64,7 +84,8 @@ class WebCrawler:
             "pages_crawled": len(self.visited_urls),
             "total_pages": self.max_pages
         }
-        print(json.dumps(progress), flush=True)
+        out = sys.stderr if self.document_stream else sys.stdout
+        print(json.dumps(progress), file=out, flush=True)
 
     def crawl(self, url, depth=0):
         if depth > self.max_depth or url in self.visited_urls or self.current_pages >= self.max_pages:
@@ -87,7 +108,11 @@ class WebCrawler:
             text_content = trafilatura.extract(page_source)
             relevance_score = self.evaluate_content(text_content)
             
-            if relevance_score > 0.5:  # Threshold for relevant content
+            if relevance_score > 0.5 and self.document_stream:
+                write_document(self.document_stream, url, text_content or '')
+                self.results.append({"url": url, "relevance": relevance_score})
+                self.print_progress(f"Found relevant content (score: {relevance_score:.2f})")
+            elif relevance_score > 0.5:  # Threshold for relevant content
                 output_path = f"temp/crawled_data_{len(self.visited_urls)}.txt"
                 Path("temp").mkdir(exist_ok=True)
                 with open(output_path, 'w', encoding='utf-8') as f:
@@ -111,6 +136,9 @@ class WebCrawler:
             return self.results
             
         except Exception as e:
+            # Nobody reads the documents any more, so stop crawling altogether
+            if is_broken_pipe(e):
+                raise
             self.print_progress(f"Error crawling {url}: {str(e)}")
             return self.results
 
@@ -134,7 +162,35 @@ def save_crawled_content(url: str, goal: str = None):
         }), flush=True)
         sys.exit(1)
 
+def stream_crawled_content(url: str, goal: str = None):
+    try:
+        crawler = WebCrawler(goal=goal, document_stream=sys.stdout.buffer)
+        crawler.crawl(url)
+    except Exception as e:
+        if is_broken_pipe(e):
+            # Keep the interpreter from failing again when it flushes stdout at exit
+            devnull = os.open(os.devnull, os.O_WRONLY)
+            os.dup2(devnull, sys.stdout.fileno())
+            sys.exit(1)
+        print(json.dumps({
+            "type": "error",
+            "success": False,
+            "error": str(e)
+        }), file=sys.stderr, flush=True)
+        sys.exit(1)
+
 if __name__ == "__main__":
+    if len(sys.argv) >= 2 and sys.argv[1] == "--stream":
+        if len(sys.argv) < 3:
+            print(json.dumps({
+                "type": "error",
+                "success": False,
+                "error": "URL argument is required"
+            }), file=sys.stderr)
+            sys.exit(1)
+        stream_crawled_content(sys.argv[2], sys.argv[3] if len(sys.argv) > 3 else None)
+        sys.exit(0)
+
     if len(sys.argv) < 2:
         print(json.dumps({
             "type": "error",
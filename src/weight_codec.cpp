@@ -0,0 +1,346 @@
+#include "weight_codec.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define WEIGHT_CODEC_SSE2 1
+#endif
+
+namespace {
+    const std::size_t BLOCK_VALUES = 64;
+    const std::size_t BLOCK_HEADER = 2;                 // min, step
+    const std::size_t BLOCK_BYTES = BLOCK_HEADER + BLOCK_VALUES / 2;
+
+    std::size_t packedSize(std::size_t values) {
+        return (values + 1) / 2;
+    }
+
+    void packNibbles(const std::uint8_t* codes, std::size_t count, std::uint8_t* out) {
+        for (std::size_t i = 0; i + 1 < count; i += 2) {
+            out[i / 2] = static_cast<std::uint8_t>(codes[i] | (codes[i + 1] << 4));
+        }
+        if (count % 2) {
+            out[count / 2] = codes[count - 1];
+        }
+    }
+
+    void malformed(const char* codec) {
+        throw std::runtime_error(std::string("Malformed ") + codec + " weight section");
+    }
+
+#ifdef WEIGHT_CODEC_SSE2
+    // Expands 16 packed bytes into 32 codes: (lo0, hi0, lo1, hi1, ...)
+    inline void unpackNibbles16(const std::uint8_t* src, __m128i& first, __m128i& second) {
+        const __m128i mask = _mm_set1_epi8(0x0F);
+        __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        __m128i lo = _mm_and_si128(packed, mask);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+        first = _mm_unpacklo_epi8(lo, hi);
+        second = _mm_unpackhi_epi8(lo, hi);
+    }
+
+    // min + code * step for 16 codes, saturated to 255
+    inline __m128i dequantize16(__m128i codes, __m128i minVec, __m128i stepVec) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(codes, zero), stepVec), minVec);
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(codes, zero), stepVec), minVec);
+        return _mm_packus_epi16(lo, hi);
+    }
+#endif
+
+    class RawCodec : public WeightCodec {
+    public:
+        WeightEncoding encoding() const override { return WeightEncoding::RAW; }
+        std::string name() const override { return "raw"; }
+        bool isLossless() const override { return true; }
+
+        std::vector<std::uint8_t> encode(const std::uint8_t* data, std::size_t length) const override {
+            return std::vector<std::uint8_t>(data, data + length);
+        }
+
+        void decode(const std::uint8_t* encoded, std::size_t encodedLength,
+                    std::uint8_t* out, std::size_t rawLength) const override {
+            if (encodedLength != rawLength) malformed("raw");
+            std::memcpy(out, encoded, rawLength);
+        }
+    };
+
+    // [shift][packed codes]: code = value >> shift, chosen so the largest value fits in 4 bits
+    class Pack4Codec : public WeightCodec {
+    public:
+        WeightEncoding encoding() const override { return WeightEncoding::PACK4; }
+        std::string name() const override { return "pack4"; }
+        bool isLossless() const override { return false; }
+
+        std::vector<std::uint8_t> encode(const std::uint8_t* data, std::size_t length) const override {
+            std::uint8_t maxValue = length ? *std::max_element(data, data + length) : 0;
+            int shift = 0;
+            while ((maxValue >> shift) > 15) ++shift;
+
+            std::vector<std::uint8_t> out(1 + packedSize(length));
+            out[0] = static_cast<std::uint8_t>(shift);
+            std::uint8_t* packed = out.data() + 1;
+            for (std::size_t i = 0; i + 1 < length; i += 2) {
+                packed[i / 2] = static_cast<std::uint8_t>((data[i] >> shift) | ((data[i + 1] >> shift) << 4));
+            }
+            if (length % 2) {
+                packed[length / 2] = static_cast<std::uint8_t>(data[length - 1] >> shift);
+            }
+            return out;
+        }
+
+        void decode(const std::uint8_t* encoded, std::size_t encodedLength,
+                    std::uint8_t* out, std::size_t rawLength) const override {
+            if (encodedLength != 1 + packedSize(rawLength) || encoded[0] > 4) malformed("pack4");
+            const int shift = encoded[0];
+            const std::uint8_t* packed = encoded + 1;
+
+            std::size_t i = 0;
+#ifdef WEIGHT_CODEC_SSE2
+            // Codes are at most 15 and shift at most 4, so 16-bit shifts never
+            // carry into the neighbouring byte
+            const __m128i shiftVec = _mm_cvtsi32_si128(shift);
+            for (; i + 32 <= rawLength; i += 32) {
+                __m128i first, second;
+                unpackNibbles16(packed + i / 2, first, second);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_sll_epi16(first, shiftVec));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 16), _mm_sll_epi16(second, shiftVec));
+            }
+#endif
+            for (; i < rawLength; ++i) {
+                std::uint8_t byte = packed[i / 2];
+                std::uint8_t code = (i % 2) ? (byte >> 4) : (byte & 0x0F);
+                out[i] = static_cast<std::uint8_t>(code << shift);
+            }
+        }
+    };
+
+    // Per 64-value block: [min][step][32 packed codes], value = min + code * step
+    class Block4Codec : public WeightCodec {
+    public:
+        WeightEncoding encoding() const override { return WeightEncoding::BLOCK4; }
+        std::string name() const override { return "block4"; }
+        bool isLossless() const override { return false; }
+
+        static std::size_t encodedSize(std::size_t length) {
+            std::size_t fullBlocks = length / BLOCK_VALUES;
+            std::size_t tail = length % BLOCK_VALUES;
+            return fullBlocks * BLOCK_BYTES + (tail ? BLOCK_HEADER + packedSize(tail) : 0);
+        }
+
+        std::vector<std::uint8_t> encode(const std::uint8_t* data, std::size_t length) const override {
+            std::vector<std::uint8_t> out(encodedSize(length));
+            std::uint8_t codes[BLOCK_VALUES];
+            std::uint8_t* dst = out.data();
+
+            for (std::size_t start = 0; start < length; start += BLOCK_VALUES) {
+                std::size_t count = std::min(BLOCK_VALUES, length - start);
+                const std::uint8_t* block = data + start;
+                auto [lo, hi] = std::minmax_element(block, block + count);
+                unsigned int minValue = *lo;
+                unsigned int range = *hi - minValue;
+                unsigned int step = range <= 15 ? 1 : (range + 14) / 15;
+
+                for (std::size_t i = 0; i < count; ++i) {
+                    unsigned int code = (block[i] - minValue + step / 2) / step;
+                    codes[i] = static_cast<std::uint8_t>(std::min(code, 15u));
+                }
+                dst[0] = static_cast<std::uint8_t>(minValue);
+                dst[1] = static_cast<std::uint8_t>(step);
+                packNibbles(codes, count, dst + BLOCK_HEADER);
+                dst += BLOCK_HEADER + packedSize(count);
+            }
+            return out;
+        }
+
+        void decode(const std::uint8_t* encoded, std::size_t encodedLength,
+                    std::uint8_t* out, std::size_t rawLength) const override {
+            if (encodedLength != encodedSize(rawLength)) malformed("block4");
+
+            const std::uint8_t* src = encoded;
+            for (std::size_t start = 0; start < rawLength; start += BLOCK_VALUES) {
+                std::size_t count = std::min(BLOCK_VALUES, rawLength - start);
+                unsigned int minValue = src[0];
+                unsigned int step = src[1];
+                const std::uint8_t* packed = src + BLOCK_HEADER;
+                std::uint8_t* dst = out + start;
+
+                std::size_t i = 0;
+#ifdef WEIGHT_CODEC_SSE2
+                const __m128i minVec = _mm_set1_epi16(static_cast<short>(minValue));
+                const __m128i stepVec = _mm_set1_epi16(static_cast<short>(step));
+                for (; i + 32 <= count; i += 32) {
+                    __m128i first, second;
+                    unpackNibbles16(packed + i / 2, first, second);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), dequantize16(first, minVec, stepVec));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 16), dequantize16(second, minVec, stepVec));
+                }
+#endif
+                for (; i < count; ++i) {
+                    std::uint8_t byte = packed[i / 2];
+                    unsigned int code = (i % 2) ? (byte >> 4) : (byte & 0x0F);
+                    dst[i] = static_cast<std::uint8_t>(std::min(minValue + code * step, 255u));
+                }
+                src += BLOCK_HEADER + packedSize(count);
+            }
+        }
+    };
+
+    // Static order-0 rANS with byte-wise renormalization. Four states are
+    // interleaved over consecutive symbols so the decoder keeps four
+    // independent dependency chains in flight.
+    // Layout: [uint16 freq[256]][rANS byte stream]
+    class RansCodec : public WeightCodec {
+    public:
+        WeightEncoding encoding() const override { return WeightEncoding::RANS; }
+        std::string name() const override { return "rans"; }
+        bool isLossless() const override { return true; }
+
+        std::vector<std::uint8_t> encode(const std::uint8_t* data, std::size_t length) const override {
+            std::uint32_t freq[256];
+            normalizeFrequencies(data, length, freq);
+            std::uint32_t cum[257];
+            cum[0] = 0;
+            for (int s = 0; s < 256; ++s) cum[s + 1] = cum[s] + freq[s];
+
+            // Each symbol emits at most two bytes at 12-bit precision
+            std::vector<std::uint8_t> stream(2 * length + 4 * LANES + 16);
+            std::uint8_t* const streamEnd = stream.data() + stream.size();
+            std::uint8_t* ptr = streamEnd;
+
+            std::uint32_t states[LANES];
+            std::fill(states, states + LANES, RANS_L);
+            for (std::size_t i = length; i-- > 0;) {
+                std::uint8_t s = data[i];
+                std::uint32_t& x = states[i % LANES];
+                std::uint32_t xMax = ((RANS_L >> PROB_BITS) << 8) * freq[s];
+                while (x >= xMax) {
+                    *--ptr = static_cast<std::uint8_t>(x & 0xFF);
+                    x >>= 8;
+                }
+                x = ((x / freq[s]) << PROB_BITS) + (x % freq[s]) + cum[s];
+            }
+            // Flush in reverse so the decoder reads state 0 first
+            for (int lane = LANES - 1; lane >= 0; --lane) {
+                ptr -= 4;
+                for (int b = 0; b < 4; ++b) {
+                    ptr[b] = static_cast<std::uint8_t>(states[lane] >> (8 * b));
+                }
+            }
+
+            std::vector<std::uint8_t> out(2 * 256 + (streamEnd - ptr));
+            for (int s = 0; s < 256; ++s) {
+                out[2 * s] = static_cast<std::uint8_t>(freq[s] & 0xFF);
+                out[2 * s + 1] = static_cast<std::uint8_t>(freq[s] >> 8);
+            }
+            std::copy(ptr, streamEnd, out.begin() + 2 * 256);
+            return out;
+        }
+
+        void decode(const std::uint8_t* encoded, std::size_t encodedLength,
+                    std::uint8_t* out, std::size_t rawLength) const override {
+            if (encodedLength < 2 * 256 + 4 * LANES) malformed("rans");
+
+            std::uint32_t freq[256];
+            std::uint32_t cum[256];
+            std::uint32_t total = 0;
+            for (int s = 0; s < 256; ++s) {
+                freq[s] = encoded[2 * s] | (encoded[2 * s + 1] << 8);
+                cum[s] = total;
+                total += freq[s];
+            }
+            if (total != PROB_SCALE) malformed("rans");
+
+            std::uint8_t slotToSymbol[PROB_SCALE];
+            for (int s = 0; s < 256; ++s) {
+                std::memset(slotToSymbol + cum[s], s, freq[s]);
+            }
+
+            const std::uint8_t* ptr = encoded + 2 * 256;
+            const std::uint8_t* const end = encoded + encodedLength;
+            std::uint32_t states[LANES];
+            for (int lane = 0; lane < LANES; ++lane) {
+                states[lane] = ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) |
+                               (static_cast<std::uint32_t>(ptr[3]) << 24);
+                ptr += 4;
+            }
+
+            const std::uint32_t mask = PROB_SCALE - 1;
+            for (std::size_t i = 0; i < rawLength; ++i) {
+                std::uint32_t& x = states[i % LANES];
+                std::uint8_t s = slotToSymbol[x & mask];
+                out[i] = s;
+                x = freq[s] * (x >> PROB_BITS) + (x & mask) - cum[s];
+                while (x < RANS_L) {
+                    if (ptr == end) malformed("rans");
+                    x = (x << 8) | *ptr++;
+                }
+            }
+        }
+
+    private:
+        static const int LANES = 4;
+        static const int PROB_BITS = 12;
+        static const std::uint32_t PROB_SCALE = 1u << PROB_BITS;
+        static const std::uint32_t RANS_L = 1u << 23;
+
+        // Scales symbol counts to sum to PROB_SCALE, keeping every present symbol
+        static void normalizeFrequencies(const std::uint8_t* data, std::size_t length,
+                                         std::uint32_t freq[256]) {
+            std::uint64_t counts[256] = {0};
+            for (std::size_t i = 0; i < length; ++i) counts[data[i]]++;
+            if (length == 0) counts[0] = 1;
+            std::uint64_t total = length ? length : 1;
+
+            std::uint32_t sum = 0;
+            for (int s = 0; s < 256; ++s) {
+                freq[s] = counts[s] ? std::max<std::uint32_t>(1, counts[s] * PROB_SCALE / total) : 0;
+                sum += freq[s];
+            }
+            // Rounding leaves the sum slightly off; settle the difference on the
+            // most frequent symbols
+            while (sum != PROB_SCALE) {
+                int largest = static_cast<int>(std::max_element(freq, freq + 256) - freq);
+                if (sum < PROB_SCALE) {
+                    freq[largest] += PROB_SCALE - sum;
+                    sum = PROB_SCALE;
+                } else {
+                    int victim = -1;
+                    for (int s = 0; s < 256; ++s) {
+                        if (freq[s] > 1 && (victim < 0 || freq[s] > freq[victim])) victim = s;
+                    }
+                    freq[victim]--;
+                    sum--;
+                }
+            }
+        }
+    };
+}
+
+const WeightCodec& codecFor(WeightEncoding encoding) {
+    static const RawCodec raw;
+    static const Pack4Codec pack4;
+    static const Block4Codec block4;
+    static const RansCodec rans;
+
+    switch (encoding) {
+        case WeightEncoding::RAW: return raw;
+        case WeightEncoding::PACK4: return pack4;
+        case WeightEncoding::BLOCK4: return block4;
+        case WeightEncoding::RANS: return rans;
+    }
+    throw std::runtime_error("Unknown weight encoding");
+}
+
+bool parseWeightEncoding(const std::string& name, WeightEncoding& encoding) {
+    for (WeightEncoding candidate : {WeightEncoding::RAW, WeightEncoding::PACK4,
+                                     WeightEncoding::BLOCK4, WeightEncoding::RANS}) {
+        if (codecFor(candidate).name() == name) {
+            encoding = candidate;
+            return true;
+        }
+    }
+    return false;
+}
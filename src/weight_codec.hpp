@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Storage encodings for a weight section. The value is stored in the model
+// file's section table, so existing values must never be renumbered.
+enum class WeightEncoding : std::uint32_t {
+    RAW = 0,        // bytes as-is
+    PACK4 = 1,      // 4-bit codes with one shift for the whole section (lossy above 15)
+    BLOCK4 = 2,     // 4-bit codes with a min/step pair per 64-byte block (lossy)
+    RANS = 3        // order-0 rANS entropy coding (lossless)
+};
+
+class WeightCodec {
+public:
+    virtual ~WeightCodec() = default;
+
+    virtual WeightEncoding encoding() const = 0;
+    virtual std::string name() const = 0;
+    virtual bool isLossless() const = 0;
+
+    virtual std::vector<std::uint8_t> encode(const std::uint8_t* data, std::size_t length) const = 0;
+    // Decodes into out[0, rawLength); throws std::runtime_error on malformed input
+    virtual void decode(const std::uint8_t* encoded, std::size_t encodedLength,
+                        std::uint8_t* out, std::size_t rawLength) const = 0;
+};
+
+// Codec registered for an encoding; throws for unknown values
+const WeightCodec& codecFor(WeightEncoding encoding);
+bool parseWeightEncoding(const std::string& name, WeightEncoding& encoding);
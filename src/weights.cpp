@@ -0,0 +1,77 @@
+#include "weights.hpp"
+#include <atomic>
+#include <stdexcept>
+
+WeightBuffer::WeightBuffer(std::vector<std::uint8_t> bytes)
+    : heap(std::make_shared<std::vector<std::uint8_t>>(std::move(bytes))) {
+}
+
+WeightBuffer WeightBuffer::fromMapping(std::shared_ptr<const MappedFile> file,
+                                       std::size_t offset, std::size_t length) {
+    if (!file || offset + length > file->size()) {
+        throw std::runtime_error("Weight range exceeds mapped file size");
+    }
+    WeightBuffer buffer;
+    buffer.mapping = std::move(file);
+    buffer.offset = offset;
+    buffer.length = length;
+    return buffer;
+}
+
+const std::uint8_t* WeightBuffer::data() const {
+    if (mapping) {
+        return mapping->data() + offset;
+    }
+    return heap ? heap->data() : nullptr;
+}
+
+std::size_t WeightBuffer::size() const {
+    if (mapping) {
+        return length;
+    }
+    return heap ? heap->size() : 0;
+}
+
+bool WeightBuffer::ownsHeap() const {
+    if (!heap || heap.use_count() != 1) {
+        return false;
+    }
+    // Pairs with the release in the last other owner's reference drop, so
+    // its reads of the bytes finish before they are overwritten here
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
+std::uint8_t* WeightBuffer::mutableData() {
+    detach();
+    return heap->data();
+}
+
+void WeightBuffer::resize(std::size_t newSize) {
+    detach();
+    heap->resize(newSize);
+}
+
+void WeightBuffer::reset(std::size_t newSize) {
+    mapping.reset();
+    offset = 0;
+    length = 0;
+    if (ownsHeap()) {
+        heap->resize(newSize);
+    } else {
+        heap = std::make_shared<std::vector<std::uint8_t>>(newSize);
+    }
+}
+
+void WeightBuffer::detach() {
+    if (mapping) {
+        const std::uint8_t* src = mapping->data() + offset;
+        heap = std::make_shared<std::vector<std::uint8_t>>(src, src + length);
+        mapping.reset();
+        offset = 0;
+        length = 0;
+    } else if (!ownsHeap()) {
+        heap = heap ? std::make_shared<std::vector<std::uint8_t>>(*heap)
+                    : std::make_shared<std::vector<std::uint8_t>>();
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "mapped_file.hpp"
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// Weight storage backed either by a heap allocation or by a read-only range
+// of a memory-mapped model file. Copies share the underlying bytes, so
+// copying a buffer costs a reference count; writing through a shared or
+// mapped buffer first gives it a private heap copy.
+class WeightBuffer {
+public:
+    WeightBuffer() = default;
+    explicit WeightBuffer(std::vector<std::uint8_t> bytes);
+
+    static WeightBuffer fromMapping(std::shared_ptr<const MappedFile> file,
+                                    std::size_t offset, std::size_t length);
+
+    const std::uint8_t* data() const;
+    std::size_t size() const;
+    bool empty() const { return size() == 0; }
+    bool isMapped() const { return mapping != nullptr; }
+
+    const std::uint8_t* begin() const { return data(); }
+    const std::uint8_t* end() const { return data() + size(); }
+
+    // Writable access; copies shared or mapped contents to the heap first
+    std::uint8_t* mutableData();
+    void resize(std::size_t newSize);
+    // Discards the current contents (and any mapping or sharing) and sizes
+    // heap storage, reusing it when this buffer is its only owner
+    void reset(std::size_t newSize);
+
+private:
+    void detach();
+    bool ownsHeap() const;
+
+    std::shared_ptr<std::vector<std::uint8_t>> heap;
+    std::shared_ptr<const MappedFile> mapping;
+    std::size_t offset = 0;
+    std::size_t length = 0;
+};